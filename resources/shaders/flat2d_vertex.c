@@ -6,11 +6,12 @@ layout(location = 1) in vec2 vertex_rel_pos;
 varying vec2 pixel_pos;
 
 uniform vec2 screen_size;
+uniform vec2 translation;
 
 void main()
 {
     pixel_pos = vertex_rel_pos;
-    gl_Position.xy = ((vec2(1,-1) * vertex_pos.xy) / screen_size.xy) * 2 + vec2(-1,1);
+    gl_Position.xy = ((vec2(1,-1) * (vertex_pos.xy + translation)) / screen_size.xy) * 2 + vec2(-1,1);
     gl_Position.w = 1.0;
 	gl_Position.z = 0.0;
 }
@@ -7,12 +7,13 @@ out vec2 uv;
 
 uniform vec2 screen_size;
 uniform vec2 text_position;
+uniform vec2 translation;
 
 uniform float size_ratio;
 
 void main()
 {
-    gl_Position.xy = ((vec2(1,-1) * text_position + size_ratio * vertex_pos.xy) / screen_size.xy) * 2 + vec2(-1,1);
+    gl_Position.xy = ((vec2(1,-1) * (text_position + translation) + size_ratio * vertex_pos.xy) / screen_size.xy) * 2 + vec2(-1,1);
     gl_Position.w = 1.0;
 	gl_Position.z = 0.0;
 	uv = vertex_uv;
@@ -14,15 +14,22 @@ public:
     {
         _element->subscribe_on_change(owner, on_change);
     }
+    void subscribe_on_change(void* owner, PropertyId prop,
+                             OnFieldChangeCallback on_change) override
+    {
+        _element->subscribe_on_change(owner, prop, on_change);
+    }
     void unsubscribe_on_change(void* owner) override 
     {
         _element->unsubscribe_on_change(owner);
     }
-    void fire_property_change(const char* prop) override
+    void fire_property_change(PropertyId prop) override
     {
         _element->fire_property_change(prop);
     }
     
+    IVisualElement* get_element() const { return _element; }
+    
     Rect arrange(const Rect& origin) override { return _element->arrange(origin); }
     void invalidate_layout() override { _element->invalidate_layout(); }
     void render(const Rect& origin) override { _element->render(origin); }
@@ -126,11 +133,16 @@ public:
     {
         _obj->subscribe_on_change(owner, on_change);
     }
+    void subscribe_on_change(void* owner, PropertyId prop,
+                             OnFieldChangeCallback on_change) override
+    {
+        _obj->subscribe_on_change(owner, prop, on_change);
+    }
     void unsubscribe_on_change(void* owner) override 
     {
         _obj->unsubscribe_on_change(owner);
     }
-    void fire_property_change(const char* prop) override
+    void fire_property_change(PropertyId prop) override
     {
         _obj->fire_property_change(prop);
     }
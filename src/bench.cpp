@@ -0,0 +1,758 @@
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+#include <numeric>
+#include <algorithm>
+#include <map>
+
+#include "ui.h"
+#include "containers.h"
+#include "adaptors.h"
+#include "parallel.h"
+#include "input.h"
+#include "serializer.h"
+#include "nonvisual.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+
+// every allocation in the process is counted, so the
+// benchmark can report how much a layout pass allocates
+static atomic<long long> allocations(0);
+
+void* operator new(size_t size)
+{
+    allocations++;
+    if (auto p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Leaf that takes part in layout but draws nothing,
+// so the benchmark can run without a GL context
+class Box : public ControlBase
+{
+public:
+    Box(const Size2& size)
+        : ControlBase("", { 0, 0 }, size, Alignment::left)
+    {}
+
+    const char* get_type() const override { return "Box"; }
+
+    void render(const Rect& origin) override { arrange(origin); }
+};
+
+// Synthetic tree, along with a leaf deep inside of it to invalidate
+struct Tree
+{
+    shared_ptr<Container> root;
+    IVisualElement* leaf = nullptr;
+    int nodes = 0;
+};
+
+class TreeBuilder
+{
+public:
+    TreeBuilder(bool margins) : _margins(margins) {}
+
+    // adopts the element, optionally wrapping it like the serializer does
+    shared_ptr<INotifyPropertyChanged> adopt(shared_ptr<ControlBase> control,
+                                             IVisualElement* parent)
+    {
+        _nodes++;
+        control->update_parent(parent);
+        if (!_margins) return control;
+        return make_shared<MarginAdaptor>(control, Margin(2));
+    }
+
+    shared_ptr<StackPanel> stack(const Size2& size, Orientation orientation)
+    {
+        return make_shared<StackPanel>("", Size2{ 0, 0 }, size,
+                                       Alignment::left, orientation);
+    }
+
+    // mix of absolute and relative sizes
+    static Size2 leaf_size(int i)
+    {
+        if (i % 3 == 0) return { Size(0.1f), Size(12) };
+        if (i % 3 == 1) return { Size(10 + i % 7), Size(12) };
+        return { Size(10 + i % 5), Size(0.5f) };
+    }
+
+    int get_nodes() const { return _nodes; }
+
+private:
+    bool _margins;
+    int _nodes = 0;
+};
+
+Tree make_wide(int rows, int columns, bool margins)
+{
+    TreeBuilder b(margins);
+    Tree t;
+    auto root = b.stack({ 1.0f, 1.0f }, Orientation::vertical);
+
+    for (auto r = 0; r < rows; r++)
+    {
+        auto row = b.stack({ 1.0f, 0 }, Orientation::horizontal);
+        for (auto c = 0; c < columns; c++)
+        {
+            auto box = make_shared<Box>(TreeBuilder::leaf_size(c));
+            row->add_item(b.adopt(box, row.get()));
+            if (r == rows / 2 && c == columns / 2) t.leaf = box.get();
+        }
+        root->add_item(b.adopt(row, root.get()));
+    }
+
+    t.root = root;
+    t.nodes = b.get_nodes() + 1;
+    return t;
+}
+
+Tree make_chain(int depth, bool margins)
+{
+    TreeBuilder b(margins);
+    Tree t;
+    auto root = b.stack({ 1.0f, 1.0f }, Orientation::vertical);
+
+    auto parent = root;
+    for (auto d = 0; d < depth; d++)
+    {
+        auto orientation = (d % 2) ? Orientation::vertical
+                                   : Orientation::horizontal;
+        auto child = b.stack({ 0, 0 }, orientation);
+        auto box = make_shared<Box>(TreeBuilder::leaf_size(d));
+        parent->add_item(b.adopt(box, parent.get()));
+        parent->add_item(b.adopt(child, parent.get()));
+        t.leaf = box.get();
+        parent = child;
+    }
+
+    t.root = root;
+    t.nodes = b.get_nodes() + 1;
+    return t;
+}
+
+Tree make_grid(int rows, int columns, bool margins)
+{
+    TreeBuilder b(margins);
+    Tree t;
+    auto grid = make_shared<Grid>("", Size2{ 0, 0 }, Size2{ 1.0f, 1.0f },
+                                  Alignment::left, Orientation::vertical);
+    grid->commit_line();
+    for (auto r = 0; r < rows; r++)
+    {
+        for (auto c = 0; c < columns; c++)
+        {
+            auto box = make_shared<Box>(Size2{ Size(8 + (r * 7 + c) % 13),
+                                               Size(10 + c % 3) });
+            grid->add_item(b.adopt(box, grid.get()));
+            if (r == rows / 2 && c == columns / 2) t.leaf = box.get();
+        }
+        grid->commit_line();
+    }
+
+    t.root = grid;
+    t.nodes = b.get_nodes() + rows + 1;
+    return t;
+}
+
+Tree make_pages(int pages, int rows, int columns, bool margins)
+{
+    Tree t;
+    auto view = make_shared<PageView>("", Size2{ 0, 0 }, Size2{ 1.0f, 1.0f },
+                                      Alignment::left);
+    for (auto p = 0; p < pages; p++)
+    {
+        auto page = make_wide(rows, columns, margins);
+        page.root->update_parent(view.get());
+        view->add_item(page.root);
+        t.nodes += page.nodes;
+        // the last page added is the one shown
+        t.leaf = page.leaf;
+    }
+
+    t.root = view;
+    t.nodes += 1;
+    return t;
+}
+
+struct Measurement
+{
+    double ms = 0;
+    long long allocations = 0;
+};
+
+template<class F>
+Measurement measure(int iterations, F step)
+{
+    auto before = allocations.load();
+    auto start = chrono::high_resolution_clock::now();
+    for (auto i = 0; i < iterations; i++) step(i);
+    auto end = chrono::high_resolution_clock::now();
+
+    Measurement m;
+    m.ms = chrono::duration<double, milli>(end - start).count() / iterations;
+    m.allocations = (allocations.load() - before) / iterations;
+    return m;
+}
+
+void report(const string& phase, const Measurement& m, int nodes)
+{
+    cout << "    " << left << setw(12) << phase << right
+         << fixed << setprecision(3) << setw(10) << m.ms << " ms"
+         << setprecision(1) << setw(10) << m.ms * 1e6 / nodes << " ns/node"
+         << setw(10) << m.allocations << " allocs" << endl;
+}
+
+void run_scenario(const string& name, function<Tree()> make, int iterations)
+{
+    Rect origin { { 0, 0 }, { 1920, 1080 } };
+
+    // construction is not timed, only the first layout of a fresh tree
+    vector<Tree> fresh;
+    for (auto i = 0; i < iterations; i++) fresh.push_back(make());
+    auto nodes = fresh.front().nodes;
+
+    cout << name << " (" << nodes << " nodes)" << endl;
+
+    auto initial = measure(iterations, [&](int i) {
+        fresh[i].root->render(origin);
+    });
+    report("initial", initial, nodes);
+
+    auto& tree = fresh.front();
+    auto steady = measure(iterations, [&](int) {
+        tree.root->render(origin);
+    });
+    report("steady", steady, nodes);
+
+    auto leaf = measure(iterations, [&](int) {
+        tree.leaf->invalidate_layout();
+        tree.root->render(origin);
+    });
+    report("leaf", leaf, nodes);
+}
+
+void collect_rects(const IVisualElement* element, vector<Rect>& rects)
+{
+    auto container = dynamic_cast<const Container*>(element);
+    if (!container) return;
+
+    for (auto& r : container->get_arranged_rects()) rects.push_back(r);
+    for (auto e : container->get_elements())
+    {
+        auto adaptor = dynamic_cast<const ElementAdaptor*>(e);
+        while (adaptor)
+        {
+            e = adaptor->get_element();
+            adaptor = dynamic_cast<const ElementAdaptor*>(e);
+        }
+        collect_rects(e, rects);
+    }
+}
+
+// Parallel layout against the serial one, on the wide tree
+int run_scaling(int max_threads, int iterations)
+{
+    auto tree = make_wide(200, 100, true);
+    Rect origin { { 0, 0 }, { 1920, 1080 } };
+
+    ParallelLayout::disable();
+    tree.root->render(origin);
+    vector<Rect> expected;
+    collect_rects(tree.root.get(), expected);
+
+    auto relayout = [&](int) {
+        tree.root->invalidate_layout();
+        tree.root->render(origin);
+    };
+
+    // threads beyond the cores only show the overhead of the pool
+    auto cores = (int)thread::hardware_concurrency();
+    cout << "scaling (" << tree.nodes << " nodes, " << cores << " cores)" << endl;
+    auto serial = measure(iterations, relayout);
+    report("serial", serial, tree.nodes);
+
+    for (auto threads = 1; threads <= max_threads; threads *= 2)
+    {
+        ParallelLayout::enable(threads);
+        auto m = measure(iterations, relayout);
+
+        vector<Rect> actual;
+        collect_rects(tree.root.get(), actual);
+        auto same = (actual.size() == expected.size()) &&
+                    equal(actual.begin(), actual.end(), expected.begin());
+
+        stringstream ss; ss << threads << " threads";
+        report(ss.str(), m, tree.nodes);
+        cout << "    speedup " << serial.ms / m.ms << endl;
+
+        if (!same)
+        {
+            cout << "    LAYOUT MISMATCH" << endl;
+            return 1;
+        }
+    }
+
+    ParallelLayout::disable();
+    return 0;
+}
+
+double percentile(vector<double> values, double p)
+{
+    if (values.empty()) return 0;
+    auto k = min(values.size() - 1, (size_t)(p * values.size()));
+    nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+void report_distribution(const string& name, const vector<double>& values,
+                         const string& unit)
+{
+    auto sum = accumulate(values.begin(), values.end(), 0.0);
+    auto max_value = values.empty() ? 0 : *max_element(values.begin(), values.end());
+    cout << "    " << left << setw(12) << name << right << fixed << setprecision(2)
+         << " mean " << (values.empty() ? 0 : sum / values.size())
+         << "  p50 " << percentile(values, 0.5)
+         << "  p95 " << percentile(values, 0.95)
+         << "  p99 " << percentile(values, 0.99)
+         << "  max " << max_value << " " << unit << endl;
+}
+
+// Feeds a session recorded by "main --record" into the wide tree, frame by
+// frame, and times every event delivered and every frame (input and layout)
+int run_replay(const string& filename, bool realtime)
+{
+    InputReplay replay(load_recording(filename));
+    auto tree = make_wide(100, 100, true);
+    Rect origin { { 0, 0 }, { 1920, 1080 } };
+    tree.root->render(origin);
+
+    InputQueue queue;
+    vector<InputEvent> events;
+    vector<double> latencies;
+    vector<double> frames;
+    auto over_budget = 0;
+
+    while (replay.next_frame(queue, realtime))
+    {
+        auto frame_start = chrono::high_resolution_clock::now();
+
+        queue.take_pending(events);
+        for (auto& e : events)
+        {
+            auto start = chrono::high_resolution_clock::now();
+            InputQueue::deliver(tree.root.get(), e);
+            auto end = chrono::high_resolution_clock::now();
+            latencies.push_back(chrono::duration<double, micro>(end - start).count());
+        }
+        tree.root->render(origin);
+
+        auto frame_end = chrono::high_resolution_clock::now();
+        frames.push_back(chrono::duration<double, milli>(frame_end - frame_start).count());
+        if (frames.back() > 1000.0 / 60) over_budget++;
+    }
+
+    cout << "replay " << filename << (realtime ? " (real time)" : " (max speed)")
+         << " on " << tree.nodes << " nodes" << endl;
+    cout << "    " << replay.get_event_count() << " events recorded, "
+         << queue.get_dispatched() << " dispatched after coalescing, "
+         << frames.size() << " frames, " << over_budget << " over 16.7 ms" << endl;
+    report_distribution("event", latencies, "us");
+    report_distribution("frame", frames, "ms");
+    return 0;
+}
+
+// The std::map storage BindableObjectBase had before SubscriberList,
+// kept as the baseline for --subscribers
+class MapSubscribers
+{
+public:
+    void add(void* owner, PropertyId prop, OnFieldChangeCallback callback)
+    {
+        _on_change[owner] = callback;
+    }
+    void remove(void* owner) { _on_change.erase(owner); }
+    void fire(PropertyId prop)
+    {
+        for (auto& evnt : _on_change) evnt.second(prop.c_str());
+    }
+
+private:
+    map<void*, OnFieldChangeCallback> _on_change;
+};
+
+template<class List>
+void run_subscriber_case(const string& name, int subscribers, int iterations)
+{
+    List list;
+    vector<int> owners(subscribers);
+    auto calls = 0;
+    PropertyId prop("value");
+    OnFieldChangeCallback callback = [&calls](const char*) { calls++; };
+
+    // every iteration subscribes all owners and then unsubscribes them
+    auto churn = measure(iterations, [&](int) {
+        for (auto& o : owners) list.add(&o, prop, callback);
+        for (auto& o : owners) list.remove(&o);
+    });
+
+    for (auto& o : owners) list.add(&o, prop, callback);
+    auto fire = measure(iterations, [&](int) { list.fire(prop); });
+
+    cout << "    " << left << setw(8) << name << right << setw(5) << subscribers
+         << fixed << setprecision(1)
+         << setw(10) << churn.ms * 1e6 / subscribers << " ns/subscribe+unsubscribe"
+         << setw(6) << churn.allocations << " allocs"
+         << setw(10) << fire.ms * 1e6 << " ns/fire" << endl;
+}
+
+int run_subscribers(int iterations)
+{
+    cout << "subscribers (" << iterations << " iterations)" << endl;
+    for (auto n : { 1, 2, 4, 8, 32, 1000, 5000 })
+    {
+        // like the children of a big container subscribing to its font
+        auto reps = n > 32 ? max(iterations * 32 / n / 100, 1) : iterations;
+        run_subscriber_case<MapSubscribers>("map", n, reps);
+        run_subscriber_case<SubscriberList>("inline", n, reps);
+    }
+    return 0;
+}
+
+// The same float and string properties twice: defined with AddProperty,
+// which reads and writes them through typed accessors, and through the
+// property classes AddProperty used before
+struct BenchValue : public BindableObjectBase
+{
+    float get_value() const { return _value; }
+    void set_value(float value) { _value = value; fire_property_change(PropertyName("value")); }
+    float get_slow_value() const { return _slow_value; }
+    void set_slow_value(float value) { _slow_value = value; fire_property_change(PropertyName("slow_value")); }
+
+    const string& get_text() const { return _text; }
+    void set_text(const string& text) { _text = text; fire_property_change(PropertyName("text")); }
+    const string& get_slow_text() const { return _slow_text; }
+    void set_slow_text(const string& text) { _slow_text = text; fire_property_change(PropertyName("slow_text")); }
+
+    float _value = 0;
+    float _slow_value = 0;
+    string _text;
+    string _slow_text;
+};
+
+template<>
+struct TypeDefinition<BenchValue>
+{
+    static shared_ptr<ITypeDefinition> make()
+    {
+        DefineClass(BenchValue)
+            ->AddProperty(get_value, set_value)
+            ->add(&__Type::get_slow_value, &__Type::set_slow_value, 
+                  "get_slow_value", "set_slow_value")
+            ->AddProperty(get_text, set_text)
+            ->add(&__Type::get_slow_text, &__Type::set_slow_text, 
+                  "get_slow_text", "set_slow_text");
+    }
+};
+
+int run_bindings(int iterations)
+{
+    auto factory = make_shared<TypeFactory>();
+    factory->register_type<BenchValue>();
+    const auto pairs = 1000;
+    const string texts[] = { "first text", "second text" };
+
+    struct Case
+    {
+        const char* property;
+        function<void(BenchValue&, int)> update;
+    };
+    vector<Case> cases {
+        { "value", [](BenchValue& v, int i) { v.set_value((float)i); } },
+        { "slow_value", [](BenchValue& v, int i) { v.set_slow_value((float)i); } },
+        { "text", [&](BenchValue& v, int i) { v.set_text(texts[i % 2]); } },
+        { "slow_text", [&](BenchValue& v, int i) { v.set_slow_text(texts[i % 2]); } },
+    };
+
+    cout << "bindings (" << pairs << " one-way pairs)" << endl;
+    for (auto& c : cases)
+    {
+        vector<unique_ptr<BenchValue>> sources, targets;
+        vector<unique_ptr<Binding>> bindings;
+        for (auto i = 0; i < pairs; i++)
+        {
+            sources.emplace_back(new BenchValue());
+            targets.emplace_back(new BenchValue());
+            bindings.emplace_back(new Binding(factory, 
+                targets.back().get(), c.property, 
+                sources.back().get(), c.property, BindingMode::OneWay));
+        }
+
+        auto m = measure(iterations, [&](int i) {
+            for (auto& s : sources) c.update(*s, i);
+        });
+        cout << "    " << left << setw(12) << c.property << right << fixed
+             << setprecision(1) << setw(10) << m.ms * 1e6 / pairs << " ns/update"
+             << setprecision(2) << setw(10) << pairs / m.ms / 1000 << " M updates/s"
+             << setw(8) << m.allocations / pairs << " allocs/update" << endl;
+    }
+    return 0;
+}
+
+// row.data_context.counter.value, as bound by rows of a table
+struct BenchContext : public BindableObjectBase
+{
+    shared_ptr<INotifyPropertyChanged> counter;
+};
+
+template<>
+struct TypeDefinition<BenchContext>
+{
+    static shared_ptr<ITypeDefinition> make()
+    {
+        DefineClass(BenchContext)->AddField(counter);
+    }
+};
+
+struct BenchRow : public BindableObjectBase
+{
+    shared_ptr<INotifyPropertyChanged> data_context;
+
+    void set_data_context(shared_ptr<INotifyPropertyChanged> dc)
+    {
+        data_context = dc;
+        fire_property_change(PropertyName("data_context"));
+    }
+};
+
+template<>
+struct TypeDefinition<BenchRow>
+{
+    static shared_ptr<ITypeDefinition> make()
+    {
+        DefineClass(BenchRow)->AddField(data_context);
+    }
+};
+
+int run_paths(int iterations)
+{
+    auto factory = make_shared<TypeFactory>();
+    factory->register_type<BenchValue>();
+    factory->register_type<BenchContext>();
+    factory->register_type<BenchRow>();
+    const auto rows = 1000;
+    const vector<PropertyId> path { PropertyId("data_context"), PropertyId("counter"), 
+                                   PropertyId("value") };
+
+    // every row switches between two items of its own, like a list
+    // that is scrolled back and forth
+    vector<shared_ptr<BenchContext>> contexts[2];
+    for (auto& items : contexts)
+    {
+        for (auto i = 0; i < rows; i++)
+        {
+            items.push_back(make_shared<BenchContext>());
+            items.back()->counter = make_shared<BenchValue>();
+        }
+    }
+
+    vector<unique_ptr<BenchRow>> sources;
+    vector<unique_ptr<BenchValue>> targets;
+    vector<unique_ptr<Binding>> bindings;
+    for (auto i = 0; i < rows; i++)
+    {
+        sources.emplace_back(new BenchRow());
+        targets.emplace_back(new BenchValue());
+        bindings.emplace_back(new PathBinding(factory, 
+            targets.back().get(), "value", sources.back().get(), path, 
+            BindingMode::OneWay));
+    }
+
+    cout << "paths (" << rows << " rows bound to data_context.counter.value)" << endl;
+    auto swap = measure(iterations, [&](int i) {
+        for (auto r = 0; r < rows; r++) 
+            sources[r]->set_data_context(contexts[i % 2][r]);
+    });
+    auto counter = measure(iterations, [&](int i) {
+        for (auto& c : contexts[1 - i % 2])
+        {
+            c->counter = make_shared<BenchValue>();
+            c->fire_property_change(PropertyName("counter"));
+        }
+    });
+    cout << "    " << left << setw(20) << "swap data_context" << right << fixed
+         << setprecision(1) << setw(10) << swap.ms * 1e6 / rows << " ns/row"
+         << setw(8) << swap.allocations / rows << " allocs/row" << endl;
+    cout << "    " << left << setw(20) << "swap counter" << right << fixed
+         << setprecision(1) << setw(10) << counter.ms * 1e6 / rows << " ns/row"
+         << setw(8) << counter.allocations / rows << " allocs/row" << endl;
+    return 0;
+}
+
+// Row of a list, showing the index of the item it is bound to
+class BenchListRow : public Box
+{
+public:
+    BenchListRow() : Box({ 100, 20 }) {}
+
+    void set_shown(int val) { _shown = val; fire_property_change(PropertyName("shown")); }
+    int get_shown() const { return _shown; }
+
+private:
+    int _shown = -1;
+};
+
+template<>
+struct TypeDefinition<BenchListRow>
+{
+    static shared_ptr<ITypeDefinition> make()
+    {
+        ExtendClass(BenchListRow, ControlBase)->AddProperty(get_shown, set_shown);
+    }
+};
+
+// Scrolls a list frame by frame with deferred changes, like main does,
+// and checks that every row shows its new item in the frame it was
+// recycled in
+int run_recycle(int frames)
+{
+    auto factory = make_shared<TypeFactory>();
+    factory->register_type<BenchListRow>();
+    factory->register_type<SequenceItem>();
+    const vector<PropertyId> path { PropertyId("data_context"), PropertyId("index") };
+
+    auto items = make_shared<Sequence>();
+    items->set_count(100000);
+    auto list = make_shared<ListView>("list", Size2{ 0, 0 }, Size2{ 1.0f, 1.0f },
+                                      Alignment::left);
+    list->set_items(items);
+
+    vector<BenchListRow*> rows;
+    list->set_item_template([&](IVisualElement* parent) {
+        auto row = make_shared<BenchListRow>();
+        row->update_parent(parent);
+        row->add_binding(unique_ptr<Binding>(new PathBinding(factory, 
+            row.get(), "shown", row.get(), path, BindingMode::OneWay)));
+        rows.push_back(row.get());
+        return row;
+    });
+
+    Rect origin { { 0, 0 }, { 800, 600 } };
+    auto stale = 0;
+    auto checked = 0;
+    ChangeDispatcher::set_deferred(true);
+    for (auto f = 0; f < frames; f++)
+    {
+        ChangeDispatcher::flush();
+        list->render(origin);
+        for (auto row : rows)
+        {
+            auto item = dynamic_cast<SequenceItem*>(row->get_data_context().get());
+            if (!item) continue;
+            checked++;
+            if (row->get_shown() != item->index) stale++;
+        }
+        list->set_scroll_offset(list->get_scroll_offset() + 57);
+    }
+    ChangeDispatcher::set_deferred(false);
+
+    cout << "recycle (" << frames << " frames, " << rows.size() << " rows): "
+         << stale << " of " << checked << " rows showed a stale item" << endl;
+    return stale ? 1 : 0;
+}
+
+int run_expressions(int iterations)
+{
+    const string texts[] = {
+        "{bind row.data_context.index}",
+        "{bind grid_with_dc.data_context.counter.count, mode=oneway}",
+        "{bind slider.value, converter=dict, mode=twoway}",
+    };
+
+    cout << "binding expressions (" << iterations << " iterations)" << endl;
+    for (auto& text : texts)
+    {
+        auto parsed = measure(iterations, [&](int) {
+            BindingExpression::parse(text);
+        });
+        auto compiled = measure(iterations, [&](int) {
+            BindingExpression::compile(text);
+        });
+        cout << "    " << left << setw(60) << text << right << fixed << setprecision(1)
+             << setw(8) << parsed.ms * 1e6 << " ns parse"
+             << setw(8) << compiled.ms * 1e6 << " ns cached"
+             << setw(6) << parsed.allocations << " / "
+             << compiled.allocations << " allocs" << endl;
+    }
+    return 0;
+}
+
+int main(int argc, char * argv[]) try
+{
+    el::Loggers::reconfigureAllLoggers(el::ConfigurationType::Enabled, "false");
+
+    auto iterations = 10;
+    auto scaling = false;
+    auto realtime = false;
+    auto subscribers = false;
+    auto bindings = false;
+    auto expressions = false;
+    auto paths = false;
+    auto recycle = false;
+    string replay_file;
+    auto max_threads = max(1, (int)thread::hardware_concurrency());
+
+    for (auto i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--scaling") scaling = true;
+        else if (arg == "--iterations" && i + 1 < argc) iterations = atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) max_threads = atoi(argv[++i]);
+        else if (arg == "--replay" && i + 1 < argc) replay_file = argv[++i];
+        else if (arg == "--realtime") realtime = true;
+        else if (arg == "--subscribers") subscribers = true;
+        else if (arg == "--bindings") bindings = true;
+        else if (arg == "--expressions") expressions = true;
+        else if (arg == "--paths") paths = true;
+        else if (arg == "--recycle") recycle = true;
+        else
+        {
+            cout << "usage: bench [--iterations N] [--scaling [--threads N]]"
+                 << " [--replay FILE [--realtime]] [--subscribers] [--bindings]"
+                 << " [--expressions] [--paths] [--recycle]" << endl;
+            return 1;
+        }
+    }
+    iterations = max(iterations, 1);
+
+    if (!replay_file.empty()) return run_replay(replay_file, realtime);
+    if (scaling) return run_scaling(max_threads, iterations);
+    if (subscribers) return run_subscribers(iterations * 100000);
+    if (bindings) return run_bindings(iterations * 1000);
+    if (expressions) return run_expressions(iterations * 1000);
+    if (paths) return run_paths(iterations * 10);
+    if (recycle) return run_recycle(iterations * 20);
+
+    run_scenario("wide stack", []() { return make_wide(100, 100, false); }, iterations);
+    run_scenario("wide stack, margins", []() { return make_wide(100, 100, true); }, iterations);
+    run_scenario("deep chain", []() { return make_chain(60, false); }, iterations);
+    run_scenario("deep chain, margins", []() { return make_chain(60, true); }, iterations);
+    run_scenario("grid", []() { return make_grid(60, 60, true); }, iterations);
+    run_scenario("pages", []() { return make_pages(8, 50, 50, true); }, iterations);
+
+    return 0;
+}
+catch(const std::exception & e)
+{
+    // logging is switched off for the benchmark
+    cerr << "Benchmark crashed! " << e.what() << endl;
+    return -1;
+}
@@ -1,30 +1,557 @@
 #include "bind.h"
+#include "profiler.h"
 
 #include "../easyloggingpp/easylogging++.h"
 
-BindableObjectBase::BindableObjectBase() : _on_change() {}
+#include <unordered_set>
+#include <algorithm>
+#include <mutex>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <vector>
 
-void BindableObjectBase::fire_property_change(const char* property_name)
+namespace
 {
-    for(auto& evnt : _on_change)
+    // nodes of an unordered_set never move, so the pointers stay valid
+    std::unordered_set<std::string>& get_property_names()
+    {
+        static std::unordered_set<std::string> names;
+        return names;
+    }
+    std::mutex property_names_lock;
+    
+    // Open addressing table over the interned names, read without a lock
+    // Names are added in place under the lock, filling an empty slot is
+    // atomic, so readers either find the name or fall back to the lock
+    struct NameTable
+    {
+        explicit NameTable(size_t size)
+            : slots(new std::atomic<const std::string*>[size]), size(size)
+        {
+            for (size_t i = 0; i < size; i++) slots[i].store(nullptr);
+        }
+        
+        std::unique_ptr<std::atomic<const std::string*>[]> slots;
+        size_t size;
+        size_t count = 0;
+    };
+    std::atomic<NameTable*> name_table { nullptr };
+    // a reader may still be probing a table that was outgrown, so they are
+    // kept; each is half the size of the next, together no bigger than it
+    std::vector<std::unique_ptr<NameTable>> outgrown_tables;
+    
+    size_t hash_name(const char* name, size_t length)
+    {
+        size_t h = 2166136261u;
+        for (size_t i = 0; i < length; i++)
+        {
+            h = (h ^ (unsigned char)name[i]) * 16777619u;
+        }
+        return h;
+    }
+    
+    const std::string* find_name(const NameTable* table, 
+                                 const char* name, size_t length)
     {
-        evnt.second(property_name);
+        if (!table) return nullptr;
+        
+        auto mask = table->size - 1;
+        for (auto i = hash_name(name, length) & mask; ; i = (i + 1) & mask)
+        {
+            auto p = table->slots[i].load(std::memory_order_acquire);
+            if (!p) return nullptr;
+            if (p->size() == length && !memcmp(p->data(), name, length)) return p;
+        }
     }
+    
+    void insert_name(NameTable& table, const std::string* name)
+    {
+        auto mask = table.size - 1;
+        auto i = hash_name(name->data(), name->size()) & mask;
+        while (table.slots[i].load(std::memory_order_relaxed)) i = (i + 1) & mask;
+        table.slots[i].store(name, std::memory_order_release);
+        table.count++;
+    }
+    
+    const std::string* intern(const char* name, size_t length)
+    {
+        auto found = find_name(name_table.load(std::memory_order_acquire), 
+                               name, length);
+        if (found) return found;
+        
+        std::lock_guard<std::mutex> lock(property_names_lock);
+        auto current = name_table.load(std::memory_order_relaxed);
+        found = find_name(current, name, length);
+        if (found) return found;
+        
+        auto interned = &*get_property_names().emplace(name, length).first;
+        
+        // kept at most half full, doubling when it would not be
+        if (current && 2 * (current->count + 1) <= current->size)
+        {
+            insert_name(*current, interned);
+            return interned;
+        }
+        
+        std::unique_ptr<NameTable> next(new NameTable(current ? 2 * current->size : 64));
+        if (current)
+        {
+            for (size_t i = 0; i < current->size; i++)
+            {
+                auto p = current->slots[i].load(std::memory_order_relaxed);
+                if (p) insert_name(*next, p);
+            }
+            outgrown_tables.emplace_back(current);
+        }
+        insert_name(*next, interned);
+        name_table.store(next.release(), std::memory_order_release);
+        return interned;
+    }
+}
+
+PropertyId::PropertyId(const char* name)
+    : _name(intern(name, strlen(name)))
+{
+}
+
+PropertyId::PropertyId(const std::string& name)
+    : _name(intern(name.data(), name.size()))
+{
+}
+
+const std::string& PropertyId::get_name() const
+{
+    static const std::string empty;
+    return _name ? *_name : empty;
+}
+
+void SubscriberList::add(void* owner, PropertyId prop, 
+                         OnFieldChangeCallback callback)
+{
+    if (_count > INLINE_COUNT)
+    {
+        auto range = _index.equal_range(owner);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            auto& r = at(it->second);
+            if (r.prop != prop) continue;
+            
+            // the old callback may be the one running right now
+            if (!_dispatching)
+            {
+                r.callback = std::move(callback);
+                return;
+            }
+            r.owner = nullptr;
+            _removed++;
+            _index.erase(it);
+            break;
+        }
+    }
+    else
+    {
+        for (auto i = 0; i < _count; i++)
+        {
+            auto& r = at(i);
+            if (r.owner == owner && r.prop == prop)
+            {
+                if (!_dispatching)
+                {
+                    r.callback = std::move(callback);
+                    return;
+                }
+                r.owner = nullptr;
+                _removed++;
+            }
+        }
+    }
+    
+    if (_count >= INLINE_COUNT) _overflow.emplace_back();
+    auto slot = _count++;
+    auto& r = at(slot);
+    r.owner = owner;
+    r.prop = prop;
+    r.callback = std::move(callback);
+    
+    if (_count == INLINE_COUNT + 1) rebuild_index();
+    else if (_count > INLINE_COUNT) _index.emplace(owner, slot);
+}
+
+void SubscriberList::remove(void* owner)
+{
+    if (!owner) return;
+    
+    while (_count > INLINE_COUNT)
+    {
+        auto it = _index.find(owner);
+        if (it == _index.end()) return;
+        
+        auto slot = it->second;
+        _index.erase(it);
+        if (_dispatching)
+        {
+            at(slot).owner = nullptr;
+            _removed++;
+        }
+        else
+        {
+            remove_at(slot);
+        }
+    }
+    
+    // the list is small, or just got small
+    for (auto i = 0; i < _count; i++)
+    {
+        auto& r = at(i);
+        if (r.owner == owner)
+        {
+            r.owner = nullptr;
+            _removed++;
+        }
+    }
+    if (!_dispatching && _removed) compact();
+}
+
+void SubscriberList::remove_at(int slot)
+{
+    auto last = _count - 1;
+    if (slot != last)
+    {
+        auto& moved = at(last);
+        auto range = _index.equal_range(moved.owner);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == last)
+            {
+                it->second = slot;
+                break;
+            }
+        }
+        at(slot) = std::move(moved);
+    }
+    
+    if (last >= INLINE_COUNT) _overflow.pop_back();
+    else _inline[last] = Record();
+    
+    _count--;
+    if (_count <= INLINE_COUNT) _index.clear();
+}
+
+void SubscriberList::rebuild_index()
+{
+    _index.clear();
+    if (_count <= INLINE_COUNT) return;
+    
+    for (auto i = 0; i < _count; i++)
+    {
+        auto& r = at(i);
+        if (r.owner) _index.emplace(r.owner, i);
+    }
+}
+
+void SubscriberList::compact()
+{
+    auto live = 0;
+    for (auto i = 0; i < _count; i++)
+    {
+        auto& r = at(i);
+        if (!r.owner) continue;
+        if (live != i) at(live) = std::move(r);
+        live++;
+    }
+    for (auto i = live; i < std::min(_count, (int)INLINE_COUNT); i++)
+    {
+        _inline[i] = Record();
+    }
+    _overflow.resize(std::max(0, live - INLINE_COUNT));
+    
+    _count = live;
+    _removed = 0;
+    rebuild_index();
+}
+
+void SubscriberList::fire(PropertyId prop)
+{
+    struct Guard
+    {
+        SubscriberList* list;
+        ~Guard()
+        {
+            if (--list->_dispatching == 0 && list->_removed) list->compact();
+        }
+    };
+    
+    _dispatching++;
+    Guard guard { this };
+    
+    // records added by the callbacks wait for the next change
+    auto count = _count;
+    for (auto i = 0; i < count; i++)
+    {
+        auto& r = at(i);
+        if (r.owner && (!r.prop.is_valid() || r.prop == prop))
+        {
+            r.callback(prop.c_str());
+        }
+    }
+}
+
+namespace
+{
+    struct PendingChange
+    {
+        BindableObjectBase* object;
+        PropertyId prop;
+    };
+    
+    struct PendingKeyHash
+    {
+        size_t operator()(const std::pair<BindableObjectBase*, PropertyId>& k) const
+        {
+            return std::hash<void*>()(k.first) * 31 + k.second.hash();
+        }
+    };
+    
+    bool deferred_changes = false;
+    bool flushing_changes = false;
+    std::vector<PendingChange> pending_changes;
+    // position of every queued pair in pending_changes
+    std::unordered_map<std::pair<BindableObjectBase*, PropertyId>, int,
+                       PendingKeyHash> pending_index;
+}
+
+void ChangeDispatcher::set_deferred(bool deferred)
+{
+    if (!deferred) flush();
+    deferred_changes = deferred;
+}
+
+bool ChangeDispatcher::is_deferred()
+{
+    return deferred_changes;
+}
+
+int ChangeDispatcher::get_pending_count()
+{
+    return (int)pending_index.size();
+}
+
+bool ChangeDispatcher::post(BindableObjectBase* object, PropertyId prop)
+{
+    if (!deferred_changes || flushing_changes) return false;
+    
+    auto key = std::make_pair(object, prop);
+    if (pending_index.find(key) == pending_index.end())
+    {
+        pending_index[key] = (int)pending_changes.size();
+        pending_changes.push_back({ object, prop });
+        object->_pending_changes++;
+    }
+    return true;
+}
+
+void ChangeDispatcher::delivered(BindableObjectBase* object, PropertyId prop)
+{
+    auto it = pending_index.find(std::make_pair(object, prop));
+    if (it == pending_index.end()) return;
+    
+    pending_changes[it->second].object = nullptr;
+    object->_pending_changes--;
+    pending_index.erase(it);
+}
+
+void ChangeDispatcher::cancel(BindableObjectBase* object)
+{
+    for (auto& change : pending_changes)
+    {
+        if (change.object != object) continue;
+        
+        pending_index.erase(std::make_pair(object, change.prop));
+        change.object = nullptr;
+    }
+    object->_pending_changes = 0;
+}
+
+void ChangeDispatcher::flush()
+{
+    if (flushing_changes) return;
+    
+    struct Guard
+    {
+        Guard() { flushing_changes = true; }
+        ~Guard()
+        {
+            flushing_changes = false;
+            for (auto& change : pending_changes)
+            {
+                if (change.object) change.object->_pending_changes--;
+            }
+            pending_changes.clear();
+            pending_index.clear();
+        }
+    } guard;
+    
+    // delivering can destroy objects further down the queue,
+    // which clears their entries, so they are read one at a time
+    for (size_t i = 0; i < pending_changes.size(); i++)
+    {
+        auto change = pending_changes[i];
+        if (!change.object) continue;
+        
+        delivered(change.object, change.prop);
+        change.object->_on_change.fire(change.prop);
+    }
+}
+
+ChangeDispatcher::Synchronous::Synchronous()
+    : _was_deferred(deferred_changes)
+{
+    set_deferred(false);
+}
+
+ChangeDispatcher::Synchronous::~Synchronous()
+{
+    deferred_changes = _was_deferred;
+}
+
+BindableObjectBase::BindableObjectBase() : _on_change() {}
+
+BindableObjectBase::~BindableObjectBase()
+{
+    if (_pending_changes) ChangeDispatcher::cancel(this);
+}
+
+void BindableObjectBase::fire_property_change(PropertyId prop)
+{
+    if (ChangeDispatcher::post(this, prop)) return;
+    
+    if (_pending_changes) ChangeDispatcher::delivered(this, prop);
+    _on_change.fire(prop);
 }
 
 void BindableObjectBase::subscribe_on_change(void* owner, 
                          OnFieldChangeCallback on_change)
 {
-    _on_change[owner] = on_change;
+    _on_change.add(owner, PropertyId(), on_change);
+}
+void BindableObjectBase::subscribe_on_change(void* owner, PropertyId prop,
+                         OnFieldChangeCallback on_change)
+{
+    _on_change.add(owner, prop, on_change);
 }
 void BindableObjectBase::unsubscribe_on_change(void* owner)
 {
-    _on_change.erase(owner);
+    _on_change.remove(owner);
+}
+
+std::shared_ptr<ITypeDefinition> TypeFactory::get_definition(
+    INotifyPropertyChanged* object)
+{
+    std::type_index type = typeid(*object);
+    
+    auto cache = _cache.load(std::memory_order_acquire);
+    if (cache)
+    {
+        if (auto found = cache->find(type)) return found->second;
+    }
+    
+    auto definition = object->make_type_definition();
+    if (!definition) definition = get_type_of(object);
+    return remember(type, definition);
+}
+
+TypeFactory::DefinitionTable::DefinitionTable(size_t size)
+    : slots(new std::atomic<const Definition*>[size]), size(size)
+{
+    for (size_t i = 0; i < size; i++) slots[i].store(nullptr);
+}
+
+const TypeFactory::Definition* TypeFactory::DefinitionTable::find(
+    std::type_index type) const
+{
+    auto mask = size - 1;
+    for (auto i = std::hash<std::type_index>()(type) & mask; ; i = (i + 1) & mask)
+    {
+        auto p = slots[i].load(std::memory_order_acquire);
+        if (!p || p->first == type) return p;
+    }
+}
+
+void TypeFactory::DefinitionTable::insert(const Definition* definition)
+{
+    auto mask = size - 1;
+    auto i = std::hash<std::type_index>()(definition->first) & mask;
+    while (slots[i].load(std::memory_order_relaxed)) i = (i + 1) & mask;
+    slots[i].store(definition, std::memory_order_release);
+    count++;
+}
+
+std::shared_ptr<ITypeDefinition> TypeFactory::remember(std::type_index type, 
+                                                       std::shared_ptr<ITypeDefinition> definition)
+{
+    std::lock_guard<std::mutex> lock(_cache_lock);
+    
+    auto inserted = _definitions.emplace(type, definition);
+    auto entry = &*inserted.first;
+    if (!inserted.second) return entry->second;
+    
+    // kept at most half full, doubling when it would not be
+    if (_table && 2 * (_table->count + 1) <= _table->size)
+    {
+        _table->insert(entry);
+        return definition;
+    }
+    
+    std::unique_ptr<DefinitionTable> next(
+        new DefinitionTable(_table ? 2 * _table->size : 32));
+    for (auto& d : _definitions) next->insert(&d);
+    
+    if (_table) _outgrown.push_back(std::move(_table));
+    _table = std::move(next);
+    _cache.store(_table.get(), std::memory_order_release);
+    return definition;
+}
+
+namespace
+{
+    std::mutex conversions_lock;
+    
+    std::map<std::pair<std::type_index, std::type_index>, 
+             ConversionRegistry::CopyFunction>& get_conversions()
+    {
+        static std::map<std::pair<std::type_index, std::type_index>, 
+                        ConversionRegistry::CopyFunction> conversions;
+        return conversions;
+    }
+}
+
+void ConversionRegistry::add(std::type_index from, std::type_index to, 
+                             CopyFunction copy)
+{
+    std::lock_guard<std::mutex> lock(conversions_lock);
+    get_conversions()[std::make_pair(from, to)] = copy;
+}
+
+ConversionRegistry::CopyFunction ConversionRegistry::find(std::type_index from, 
+                                                          std::type_index to)
+{
+    std::lock_guard<std::mutex> lock(conversions_lock);
+    auto it = get_conversions().find(std::make_pair(from, to));
+    if (it == get_conversions().end()) return nullptr;
+    return it->second;
 }
 
 void Binding::a_to_b()
 {
-    if (_is_direct)
+    if (!_b_prop_ptr) return;
+    
+    BindingProfiler::Update profile(this, true);
+    if (_accessor_copy)
+    {
+        _accessor_copy(_a_accessor, _a, _b_accessor, _b);
+    }
+    else if (_is_direct)
     {
         _direct_b->copy_from(_direct_a);
     }
@@ -34,19 +561,31 @@ void Binding::a_to_b()
         {
             if (_converter_state->get(0) && _converter_state->get(1))
             {
-                _direct_a->copy_to(_converter_state->get(1));
-                _converter->apply(*_converter_state, _converter_direction);
-                _direct_b->copy_from(_converter_state->get(0));
+                _direct_a->copy_to(_converter_state->get(_a_slot));
+                {
+                    BindingProfiler::Converter timing;
+                    _converter->apply(*_converter_state, _converter_direction);
+                }
+                _direct_b->copy_from(_converter_state->get(_b_slot));
             }
             else
             {
-                _converter_state->set_value(1, _a_prop_ptr->get_value());
-                _converter->apply(*_converter_state, _converter_direction);
-                _b_prop_ptr->set_value(_converter_state->get_value(0));
+                BindingProfiler::count_string_fallback();
+                _converter_state->set_value(_a_slot, _a_prop_ptr->get_value());
+                {
+                    BindingProfiler::Converter timing;
+                    _converter->apply(*_converter_state, _converter_direction);
+                }
+                _b_prop_ptr->set_value(_converter_state->get_value(_b_slot));
             }
         }
+        else if (_copy_a_to_b)
+        {
+            _copy_a_to_b(_direct_a, _direct_b);
+        }
         else
         {
+            BindingProfiler::count_string_fallback();
             _b_prop_ptr->set_value(_a_prop_ptr->get_value());
         }
     }
@@ -54,7 +593,14 @@ void Binding::a_to_b()
 
 void Binding::b_to_a()
 {
-    if (_is_direct)
+    if (!_b_prop_ptr) return;
+    
+    BindingProfiler::Update profile(this, false);
+    if (_accessor_copy)
+    {
+        _accessor_copy(_b_accessor, _b, _a_accessor, _a);
+    }
+    else if (_is_direct)
     {
         _direct_a->copy_from(_direct_b);
     }
@@ -64,19 +610,31 @@ void Binding::b_to_a()
         {
             if (_converter_state->get(0) && _converter_state->get(1))
             {
-                _direct_b->copy_to(_converter_state->get(0));
-                _converter->apply(*_converter_state, !_converter_direction);
-                _direct_a->copy_from(_converter_state->get(1));
+                _direct_b->copy_to(_converter_state->get(_b_slot));
+                {
+                    BindingProfiler::Converter timing;
+                    _converter->apply(*_converter_state, !_converter_direction);
+                }
+                _direct_a->copy_from(_converter_state->get(_a_slot));
             }
             else
             {
-                _converter_state->set_value(0, _b_prop_ptr->get_value());
-                _converter->apply(*_converter_state, !_converter_direction);
-                _a_prop_ptr->set_value(_converter_state->get_value(1));
+                BindingProfiler::count_string_fallback();
+                _converter_state->set_value(_b_slot, _b_prop_ptr->get_value());
+                {
+                    BindingProfiler::Converter timing;
+                    _converter->apply(*_converter_state, !_converter_direction);
+                }
+                _a_prop_ptr->set_value(_converter_state->get_value(_a_slot));
             }
         }
+        else if (_copy_b_to_a)
+        {
+            _copy_b_to_a(_direct_b, _direct_a);
+        }
         else
         {
+            BindingProfiler::count_string_fallback();
             _a_prop_ptr->set_value(_b_prop_ptr->get_value());
         }
     }
@@ -87,20 +645,23 @@ Binding::Binding(std::shared_ptr<TypeFactory> factory,
                  INotifyPropertyChanged* b, std::string b_prop,
                  BindingMode mode,
                  std::shared_ptr<ITypeConverter> converter)
+    : Binding(factory, a, PropertyId(a_prop), b, PropertyId(b_prop), 
+              mode, converter)
+{
+}
+
+Binding::Binding(std::shared_ptr<TypeFactory> factory,
+                 INotifyPropertyChanged* a, PropertyId a_prop,
+                 INotifyPropertyChanged* b, PropertyId b_prop,
+                 BindingMode mode,
+                 std::shared_ptr<ITypeConverter> converter)
     : _factory(factory)
 {
-    _a_dc = a->make_type_definition();
-    if (!_a_dc) _a_dc = _factory->get_type_of(a);
-    _b_dc = b->make_type_definition();
-    if (!_b_dc) _b_dc = _factory->get_type_of(b);
-    _a = a; _b = b;
+    _a_dc = _factory->get_definition(a);
+    _a = a;
     _a_prop = a_prop;
     _b_prop = b_prop;
-    
-    _id = str() << "binding from object of type " << typeid(*a).name()
-              << ", property " << a_prop << " to object of type " << typeid(*b).name()
-              << ", property " << b_prop;
-    LOG(INFO) << "Created " << _id;
+    _mode = mode;
     
     _converter = converter;
     if (_converter)
@@ -108,20 +669,54 @@ Binding::Binding(std::shared_ptr<TypeFactory> factory,
         _converter_state = _converter->make_state();
     }
     
-    _a_prop_def = _a_dc->get_property(a_prop);
+    _a_prop_def = _a_dc->get_property(a_prop.get_name());
     if (!_a_prop_def) 
-        throw std::runtime_error(str() << "Property " << a_prop << " not found!");
+        throw std::runtime_error(str() << "Property " << a_prop.get_name() << " not found!");
     _a_prop_ptr = _a_prop_def->create(a);
+    _direct_a = dynamic_cast<ICopyable*>(_a_prop_ptr.get());
     
-    _b_prop_def = _b_dc->get_property(b_prop);
+    if (mode == BindingMode::TwoWay)
+    {
+        _a_prop_ptr->subscribe_on_change(this, [=](IProperty* sender)
+        {
+            if (!_skip_a && _b_prop_ptr && _b_prop_def->is_writable())
+            {
+                _skip_b = true;
+                a_to_b();
+                _skip_b = false;
+            }
+        });
+    }
+    
+    set_b(b);
+}
+
+std::string Binding::describe() const
+{
+    return str() << "binding from object of type " << typeid(*_a).name()
+                 << ", property " << _a_prop.get_name() << " to object of type " 
+                 << (_b ? typeid(*_b).name() : "(none)")
+                 << ", property " << _b_prop.get_name();
+}
+
+void Binding::resolve_b()
+{
+    _b_prop_def = _b_dc->get_property(_b_prop.get_name());
     if (!_b_prop_def) 
-        throw std::runtime_error(str() << "Property " << b_prop << " not found!");
-    _b_prop_ptr = _b_prop_def->create(b);
+        throw std::runtime_error(str() << "Property " << _b_prop.get_name() << " not found!");
     
     _is_direct = _a_prop_def->get_type() == _b_prop_def->get_type();
-    _direct_a = dynamic_cast<ICopyable*>(_a_prop_ptr.get());
-    _direct_b = dynamic_cast<ICopyable*>(_b_prop_ptr.get());
     
+    _a_accessor = _a_prop_def->get_accessor();
+    _b_accessor = _b_prop_def->get_accessor();
+    _accessor_copy = nullptr;
+    if (_is_direct && !_converter && _a_accessor && _b_accessor)
+    {
+        // getter of one straight into the setter of the other
+        _accessor_copy = _a_prop_def->get_accessor_copy();
+    }
+    
+    _copy_a_to_b = _copy_b_to_a = nullptr;
     if (_converter)
     {
         auto _b_type = _b_prop_def->get_type();
@@ -148,25 +743,68 @@ Binding::Binding(std::shared_ptr<TypeFactory> factory,
         }*/
         _is_direct = false;
         
+        // slot 0 of the converter state holds its "from" type, slot 1 its "to"
         _converter_direction = _a_prop_def->get_type() != _converter->get_to();
+        _a_slot = _converter_direction ? 0 : 1;
+        _b_slot = 1 - _a_slot;
+    }
+    else if (!_is_direct)
+    {
+        _copy_a_to_b = ConversionRegistry::find(_a_prop_def->get_type_index(), 
+                                                _b_prop_def->get_type_index());
+        _copy_b_to_a = ConversionRegistry::find(_b_prop_def->get_type_index(), 
+                                                _a_prop_def->get_type_index());
+        if (!_copy_a_to_b || !_copy_b_to_a)
+        {
+            LOG(WARNING) << "No typed conversion between " << _a_prop_def->get_type()
+                         << " and " << _b_prop_def->get_type() << ", the " 
+                         << describe() << " goes through strings";
+        }
     }
     
-    if (_b_prop_def->is_writable() && mode == BindingMode::TwoWay)
+    if (!_a_prop_def->is_writable() && 
+        !(_b_prop_def->is_writable() && _mode == BindingMode::TwoWay))
     {
-        _a_prop_ptr->subscribe_on_change(this, [=](IProperty* sender)
+        throw std::runtime_error("Both properties under binding can't be read-only!");
+    }
+}
+
+void Binding::set_b(INotifyPropertyChanged* b)
+{
+    if (b == _b) return;
+    
+    if (_b_prop_ptr)
+    {
+        _b_prop_ptr->unsubscribe_on_change(this);
+        _b_prop_ptr.reset();
+        _direct_b = nullptr;
+    }
+    _b = b;
+    if (!b) return;
+    
+    // everything resolved from the type is kept while the type stays the same
+    auto dc = _factory->get_definition(b);
+    if (dc != _b_dc)
+    {
+        _b_dc = dc;
+        try
         {
-            if (!_skip_a)
-            {
-                _skip_b = true;
-                a_to_b();
-                _skip_b = false;
-            }
-        });
+            resolve_b();
+        }
+        catch (...)
+        {
+            _b = nullptr;
+            _b_dc = nullptr;
+            throw;
+        }
     }
     
+    _b_prop_ptr = _b_prop_def->create(b);
+    _direct_b = dynamic_cast<ICopyable*>(_b_prop_ptr.get());
+    
     if (_a_prop_def->is_writable() &&
-            (mode == BindingMode::TwoWay ||
-             mode == BindingMode::OneWay))
+            (_mode == BindingMode::TwoWay ||
+             _mode == BindingMode::OneWay))
     {
         _b_prop_ptr->subscribe_on_change(this, [=](IProperty* sender)
         {
@@ -185,22 +823,136 @@ Binding::Binding(std::shared_ptr<TypeFactory> factory,
         b_to_a();
         _skip_a = false;
     }
-    else if (_b_prop_def->is_writable() && mode == BindingMode::TwoWay)
+    else
     {
         _skip_b = true;
         a_to_b();
-        _skip_b = true;
-    }
-    else
-    {
-        throw std::runtime_error("Both properties under binding can't be read-only!");
+        _skip_b = false;
     }
 }
 
 Binding::~Binding()
 {
+    BindingProfiler::forget(this);
     _a_prop_ptr->unsubscribe_on_change(this);
-    _b_prop_ptr->unsubscribe_on_change(this);
+    if (_b_prop_ptr) _b_prop_ptr->unsubscribe_on_change(this);
+}
+
+PathBinding::PathBinding(std::shared_ptr<TypeFactory> factory,
+                         INotifyPropertyChanged* a, std::string a_prop,
+                         INotifyPropertyChanged* b, 
+                         const std::vector<PropertyId>& path,
+                         BindingMode mode,
+                         std::shared_ptr<ITypeConverter> converter)
+    : PathBinding(factory, a, PropertyId(a_prop), b, path, mode, converter)
+{
+}
+
+PathBinding::PathBinding(std::shared_ptr<TypeFactory> factory,
+                         INotifyPropertyChanged* a, PropertyId a_prop,
+                         INotifyPropertyChanged* b, 
+                         const std::vector<PropertyId>& path,
+                         BindingMode mode,
+                         std::shared_ptr<ITypeConverter> converter)
+    : Binding(factory, a, a_prop, nullptr, path.back(), mode, converter),
+      _segments(path.size() - 1)
+{
+    for (auto i = 0; i < (int)_segments.size(); i++)
+    {
+        _segments[i].id = path[i];
+    }
+    
+    try
+    {
+        retarget(0, b);
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+}
+
+PathBinding::~PathBinding()
+{
+    release();
+}
+
+void PathBinding::release()
+{
+    // the end of the path is still watched by the Binding, detach it
+    // before dropping the objects that keep it alive
+    set_b(nullptr);
+    for (auto& s : _segments)
+    {
+        if (s.object) s.object->unsubscribe_on_change(&s);
+        s.object = nullptr;
+    }
+    for (auto& s : _segments) s.value = nullptr;
+}
+
+void PathBinding::retarget(int level, INotifyPropertyChanged* object)
+{
+    if (level == (int)_segments.size())
+    {
+        set_b(object);
+        return;
+    }
+    
+    auto& s = _segments[level];
+    if (object == s.object) return;
+    
+    if (s.object) s.object->unsubscribe_on_change(&s);
+    s.object = object;
+    
+    if (object)
+    {
+        auto dc = get_factory()->get_definition(object);
+        if (dc != s.type)
+        {
+            s.type = nullptr;
+            auto def = dc->get_property(s.id.get_name());
+            if (!def)
+                throw std::runtime_error(str() << "Property " << s.id.get_name() 
+                                         << " not found!");
+            s.def = def;
+            s.accessor = nullptr;
+            if (def->get_type_index() == typeid(std::shared_ptr<INotifyPropertyChanged>))
+            {
+                s.accessor = static_cast<const ObjectAccessor*>(def->get_accessor());
+            }
+            s.type = dc;
+        }
+        
+        object->subscribe_on_change(&s, s.id, [this, level](const char*) {
+            update(level);
+        });
+    }
+    
+    update(level);
+}
+
+void PathBinding::update(int level)
+{
+    auto& s = _segments[level];
+    
+    std::shared_ptr<INotifyPropertyChanged> next;
+    if (s.object && s.accessor)
+    {
+        next = s.accessor->get(s.object);
+    }
+    else if (s.object)
+    {
+        auto prop = s.def->create(s.object);
+        auto typed = dynamic_cast<PropertyBase<std::shared_ptr<INotifyPropertyChanged>>*>(
+            prop.get());
+        if (!typed)
+            throw std::runtime_error(str() << "Property " << s.id.get_name() 
+                                     << " is not an object!");
+        next = typed->get();
+    }
     
-    LOG(INFO) << "Removed " << _id;
+    // the previous object is released only once nothing after it watches it
+    retarget(level + 1, next.get());
+    s.value = std::move(next);
 }
@@ -5,6 +5,12 @@
 #include <memory>
 #include <string>
 #include <map>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 #include <typeinfo>
 #include <type_traits>
 #include <typeindex>
@@ -14,6 +20,44 @@
 
 class IProperty;
 
+// Property name interned into a process-wide table
+// Two ids of the same name share the same pointer, so comparing and hashing
+// them never touches the characters. Converting from a string does a table
+// lookup, the reflection layer does it once per property definition.
+// Literals are converted explicitly, use PropertyName to do it once
+class PropertyId
+{
+public:
+    PropertyId() : _name(nullptr) {}
+    explicit PropertyId(const char* name);
+    PropertyId(const std::string& name);
+    
+    const std::string& get_name() const;
+    const char* c_str() const { return get_name().c_str(); }
+    bool is_valid() const { return _name != nullptr; }
+    
+    bool operator==(const PropertyId& other) const { return _name == other._name; }
+    bool operator!=(const PropertyId& other) const { return _name != other._name; }
+    
+    size_t hash() const { return std::hash<const void*>()(_name); }
+    
+private:
+    const std::string* _name;
+};
+
+// Id of a name known at compile time, interned once per call site
+#define PropertyName(name) \
+    ([]() -> const PropertyId& { static const PropertyId id(name); return id; }())
+
+namespace std
+{
+    template<>
+    struct hash<PropertyId>
+    {
+        size_t operator()(const PropertyId& id) const { return id.hash(); }
+    };
+}
+
 typedef std::function<void(IProperty* prop)> 
         OnPropertyChangeCallback;
         
@@ -39,6 +83,13 @@ public:
 
 class INotifyPropertyChanged;
 
+// Copies a value between two properties of the same type, given their
+// PropertyAccessor<S> (see below) and their owners
+typedef void (*AccessorCopy)(const void* from_accessor, 
+                             const INotifyPropertyChanged* from,
+                             const void* to_accessor, 
+                             INotifyPropertyChanged* to);
+
 class IPropertyDefinition : public IVirtualBase
 {
 public:
@@ -46,9 +97,15 @@ public:
         (INotifyPropertyChanged* owner) const = 0;
     
     virtual const std::string& get_type() const = 0;
+    virtual std::type_index get_type_index() const = 0;
     virtual const std::string& get_name() const = 0;
+    virtual PropertyId get_id() const = 0;
     
     virtual bool is_writable() const = 0;
+    
+    // Typed accessor of the property, nullptr if it was defined without one
+    virtual const void* get_accessor() const = 0;
+    virtual AccessorCopy get_accessor_copy() const = 0;
 };
 
 class ITypeDefinition : public IVirtualBase
@@ -66,10 +123,15 @@ public:
 class INotifyPropertyChanged : public IVirtualBase
 {
 public:
-    virtual void fire_property_change(const char* prop) = 0;
+    virtual void fire_property_change(PropertyId prop) = 0;
 
+    // Called back on a change of any property
     virtual void subscribe_on_change(void* owner, 
                                      OnFieldChangeCallback on_change) = 0;
+    // Called back only on changes of prop, an owner can watch several
+    virtual void subscribe_on_change(void* owner, PropertyId prop,
+                                     OnFieldChangeCallback on_change) = 0;
+    // Drops every subscription of the owner
     virtual void unsubscribe_on_change(void* owner) = 0;
     
     virtual std::shared_ptr<ITypeDefinition> make_type_definition() const
@@ -87,6 +149,9 @@ struct TypeDefinition
     std::shared_ptr<ITypeDefinition> make();
 };
 
+template<class T>
+std::shared_ptr<ITypeDefinition> get_static_definition();
+
 template<class... T>
 struct TypeCollection
 {
@@ -97,13 +162,17 @@ class TypeFactory
 public:
     TypeFactory() {}
     
+    TypeFactory(const TypeFactory&) = delete;
+    TypeFactory& operator=(const TypeFactory&) = delete;
+    
     template<class T>
     void register_type() 
     {
-        auto ptr = TypeDefinition<T>::make();
+        auto ptr = get_static_definition<T>();
         _types.push_back(ptr);
         _name_to_type[ptr->get_type()] = ptr;
         _typeid_to_type[typeid(T)] = ptr;
+        remember(typeid(T), ptr);
     }
     
     template<class T, class... S>
@@ -159,24 +228,158 @@ public:
         }
     }
     
+    // Definition of the dynamic type of the object, memoized per type
+    // An object describing itself through make_type_definition is only
+    // asked once for its type, so the description must not depend on the
+    // instance. Reading a type seen before takes no lock
+    std::shared_ptr<ITypeDefinition> get_definition(INotifyPropertyChanged* object);
+    
 private:
+    typedef std::unordered_map<std::type_index, std::shared_ptr<ITypeDefinition>> 
+            DefinitionMap;
+    typedef DefinitionMap::value_type Definition;
+    
+    // Open addressing table over the entries of _definitions, read without
+    // a lock. Entries are added in place under the lock, filling an empty
+    // slot is atomic, so readers either find the type or take the lock
+    struct DefinitionTable
+    {
+        explicit DefinitionTable(size_t size);
+        
+        const Definition* find(std::type_index type) const;
+        void insert(const Definition* definition);
+        
+        std::unique_ptr<std::atomic<const Definition*>[]> slots;
+        size_t size;
+        size_t count = 0;
+    };
+    
+    // Returns the definition remembered first, when two threads race
+    std::shared_ptr<ITypeDefinition> remember(std::type_index type, 
+                                              std::shared_ptr<ITypeDefinition> definition);
+
     std::vector<std::shared_ptr<ITypeDefinition>> _types;
     std::unordered_map<std::string, std::shared_ptr<ITypeDefinition>> _name_to_type;
     std::unordered_map<std::type_index, std::shared_ptr<ITypeDefinition>> _typeid_to_type;
+    
+    // map nodes never move, so the table can point into it
+    DefinitionMap _definitions;
+    std::unique_ptr<DefinitionTable> _table;
+    std::atomic<const DefinitionTable*> _cache { nullptr };
+    // a reader may still be probing a table that was outgrown, so they are
+    // kept; each is half the size of the next, together no bigger than it
+    std::vector<std::unique_ptr<DefinitionTable>> _outgrown;
+    std::mutex _cache_lock;
+};
+
+// Change subscribers of one object, the first few stored inline
+// A record holds the owner, the property it watches (none for any change)
+// and the callback. Subscribing and unsubscribing are safe from inside a
+// callback: removed records are only marked while a change is dispatched
+// and compacted after the outermost dispatch, added ones are first called
+// on the next change. Lists that spill out of the inline records are
+// indexed by owner, a removed record is replaced by the last one, so
+// callbacks are not called in the order they subscribed
+class SubscriberList
+{
+public:
+    SubscriberList() {}
+    SubscriberList(const SubscriberList&) = delete;
+    SubscriberList& operator=(const SubscriberList&) = delete;
+    
+    // Replaces the callback if the owner already watches the property
+    void add(void* owner, PropertyId prop, OnFieldChangeCallback callback);
+    // Drops every record of the owner
+    void remove(void* owner);
+    
+    void fire(PropertyId prop);
+    
+    int size() const { return _count - _removed; }
+    
+private:
+    struct Record
+    {
+        void* owner = nullptr;
+        PropertyId prop;
+        OnFieldChangeCallback callback;
+    };
+    
+    static const int INLINE_COUNT = 4;
+    
+    Record& at(int i)
+    {
+        return i < INLINE_COUNT ? _inline[i] : _overflow[i - INLINE_COUNT];
+    }
+    void compact();
+    void remove_at(int slot);
+    void rebuild_index();
+    
+    Record _inline[INLINE_COUNT];
+    // a deque, so that growing it never moves a callback that is running
+    std::deque<Record> _overflow;
+    // slots of every owner, kept only while there are more than INLINE_COUNT
+    std::unordered_multimap<void*, int> _index;
+    int _count = 0;
+    int _removed = 0;
+    int _dispatching = 0;
+};
+
+class BindableObjectBase;
+
+// Switch between delivering changes as they are fired and once per frame
+// In deferred mode fire_property_change only queues the (object, property)
+// pair, and a pair that is already queued is not queued again, so a value
+// changing many times within a frame is propagated once. flush delivers the
+// queue in the order the pairs were first fired; the cascades it starts run
+// synchronously, and pairs they deliver on the way are dropped from the
+// queue. Everything here is meant for the UI thread only
+class ChangeDispatcher
+{
+public:
+    // Turning deferral off flushes whatever is queued
+    static void set_deferred(bool deferred);
+    static bool is_deferred();
+    
+    static void flush();
+    static int get_pending_count();
+    
+    // Delivers changes synchronously while in scope, for code that
+    // reads bound values right after changing their source
+    class Synchronous
+    {
+    public:
+        Synchronous();
+        ~Synchronous();
+    private:
+        bool _was_deferred;
+    };
+    
+private:
+    friend class BindableObjectBase;
+    
+    static bool post(BindableObjectBase* object, PropertyId prop);
+    static void delivered(BindableObjectBase* object, PropertyId prop);
+    static void cancel(BindableObjectBase* object);
 };
 
 class BindableObjectBase : public INotifyPropertyChanged
 {
 public:
     BindableObjectBase();
+    ~BindableObjectBase();
     
-    void fire_property_change(const char* property_name) override;
+    void fire_property_change(PropertyId prop) override;
     void subscribe_on_change(void* owner, 
                              OnFieldChangeCallback on_change) override;
+    void subscribe_on_change(void* owner, PropertyId prop,
+                             OnFieldChangeCallback on_change) override;
     void unsubscribe_on_change(void* owner) override;
     
 private:
-    std::map<void*,OnFieldChangeCallback> _on_change;
+    friend class ChangeDispatcher;
+    
+    SubscriberList _on_change;
+    int _pending_changes = 0;
 };
 
 class ICopyable : public IVirtualBase
@@ -191,19 +394,15 @@ class PropertyBase : public IProperty, public ICopyable
 {
 public:
 
-    PropertyBase(INotifyPropertyChanged* owner,
-                 const std::string& name) 
-        : _owner(owner), _on_change()
+    PropertyBase(INotifyPropertyChanged* owner, PropertyId id) 
+        : _on_change(), _owner(owner)
     {
         if (owner)
-            owner->subscribe_on_change(this,
-                [this, name](const char* field){
-                    if (field == name)
+            owner->subscribe_on_change(this, id,
+                [this](const char* field){
+                    for(auto& evnt : _on_change)
                     {
-                        for(auto& evnt : _on_change)
-                        {
-                            evnt.second(this);
-                        }
+                        evnt.second(this);
                     }
                 });
     }
@@ -256,7 +455,200 @@ private:
     INotifyPropertyChanged* _owner;
 };
 
-typedef std::function<IProperty*(INotifyPropertyChanged*, const std::string&)>
+// Value conversion between two property types, never through a string
+// unless one of the two is a string
+template<class T, class S>
+struct Convert
+{
+    static S apply(const T& x) { return static_cast<S>(x); }
+};
+
+template<class T>
+struct Convert<T, std::string>
+{
+    static std::string apply(const T& x) { return type_string_traits::to_string(x); }
+};
+
+template<class S>
+struct Convert<std::string, S>
+{
+    static S apply(const std::string& x) { return type_string_traits::parse(x, (S*)(nullptr)); }
+};
+
+template<class T>
+struct Convert<std::shared_ptr<T>, bool>
+{
+    static bool apply(const std::shared_ptr<T>& x) { return x != nullptr; }
+};
+
+// Typed copy functions between properties of different types
+// Bindings look the pair of types up once, when they are created,
+// and later updates call the function without any lookup
+class ConversionRegistry
+{
+public:
+    typedef void (*CopyFunction)(ICopyable* from, ICopyable* to);
+    
+    template<class T, class S>
+    static void add()
+    {
+        add(typeid(T), typeid(S), &copy<T, S>);
+    }
+    
+    // nullptr if the pair was never registered
+    static CopyFunction find(std::type_index from, std::type_index to);
+    
+private:
+    template<class T, class S>
+    static void copy(ICopyable* from, ICopyable* to)
+    {
+        auto f = static_cast<PropertyBase<T>*>(from);
+        auto t = static_cast<PropertyBase<S>*>(to);
+        t->set(Convert<T, S>::apply(f->get()));
+    }
+    
+    static void add(std::type_index from, std::type_index to, CopyFunction copy);
+};
+
+// Conversions a property type takes part in, registered the first
+// time a property of the type is defined
+template<class S>
+void add_string_conversions()
+{
+    ConversionRegistry::add<S, std::string>();
+    ConversionRegistry::add<std::string, S>();
+}
+
+template<class S, class N>
+void add_numeric_conversion()
+{
+    ConversionRegistry::add<S, N>();
+    ConversionRegistry::add<N, S>();
+}
+
+template<class S>
+typename std::enable_if<std::is_arithmetic<S>::value>::type 
+    register_conversions(S*)
+{
+    add_string_conversions<S>();
+    if (!std::is_same<S, int>::value) add_numeric_conversion<S, int>();
+    if (!std::is_same<S, float>::value) add_numeric_conversion<S, float>();
+    if (!std::is_same<S, bool>::value) add_numeric_conversion<S, bool>();
+}
+
+template<class S>
+typename std::enable_if<std::is_enum<S>::value>::type 
+    register_conversions(S*)
+{
+    add_string_conversions<S>();
+    add_numeric_conversion<S, int>();
+}
+
+template<class S>
+typename std::enable_if<!std::is_arithmetic<S>::value && 
+                        !std::is_enum<S>::value>::type 
+    register_conversions(S*)
+{
+    add_string_conversions<S>();
+}
+
+template<class S>
+void register_conversions(std::shared_ptr<S>*)
+{
+    add_string_conversions<std::shared_ptr<S>>();
+    ConversionRegistry::add<std::shared_ptr<S>, bool>();
+}
+
+inline void register_conversions(std::string*)
+{
+}
+
+// Getter and setter of one property as plain functions, each one
+// instantiated for the exact member it wraps, so the member call is
+// inlined into it and nothing on the way is virtual
+template<class S>
+struct PropertyAccessor
+{
+    S (*get)(const INotifyPropertyChanged* owner);
+    void (*set)(INotifyPropertyChanged* owner, const S& value);
+};
+
+template<class S>
+void copy_with_accessors(const void* from_accessor, const INotifyPropertyChanged* from,
+                         const void* to_accessor, INotifyPropertyChanged* to)
+{
+    auto f = static_cast<const PropertyAccessor<S>*>(from_accessor);
+    auto t = static_cast<const PropertyAccessor<S>*>(to_accessor);
+    t->set(to, f->get(from));
+}
+
+template<class M>
+struct member_traits;
+
+template<class C, class R>
+struct member_traits<R (C::*)() const>
+{
+    typedef typename std::decay<R>::type value_type;
+};
+
+template<class C, class R>
+struct member_traits<R C::*>
+{
+    typedef R value_type;
+};
+
+template<class T, class S, class R, R r>
+S call_getter(const INotifyPropertyChanged* owner)
+{
+    return (static_cast<const T*>(owner)->*r)();
+}
+
+template<class T, class S, class W, W w>
+void call_setter(INotifyPropertyChanged* owner, const S& value)
+{
+    (static_cast<T*>(owner)->*w)(value);
+}
+
+template<class T, class S, class F, F f>
+S get_field(const INotifyPropertyChanged* owner)
+{
+    return static_cast<const T*>(owner)->*f;
+}
+
+template<class T, class S, class F, F f>
+void set_field(INotifyPropertyChanged* owner, const S& value)
+{
+    static_cast<T*>(owner)->*f = value;
+}
+
+template<class S>
+class AccessorProperty : public PropertyBase<S>
+{
+public:
+    AccessorProperty(INotifyPropertyChanged* owner, PropertyId id,
+                     const PropertyAccessor<S>& accessor) 
+        : PropertyBase<S>(owner, id), _owner(owner), _accessor(accessor)
+    {
+    }
+    
+    void set(S val) override
+    {
+        if (!_accessor.set) 
+            throw std::runtime_error(str() << "Property is read-only!");
+        _accessor.set(_owner, val);
+    }
+    
+    S get() const override
+    {
+        return _accessor.get(_owner);
+    }
+
+private:
+    INotifyPropertyChanged* _owner;
+    PropertyAccessor<S> _accessor;
+};
+
+typedef std::function<IProperty*(INotifyPropertyChanged*, PropertyId)>
         PropertyCreator;
 
 template<class S>
@@ -266,25 +658,54 @@ public:
     PropertyDefinition(std::string name, bool is_writable,
                        PropertyCreator creator) 
         : _name(name), 
+          _id(_name),
+          _type(type_string_traits::type_to_string((S*)(nullptr))),
+          _is_writable(is_writable),
           _creator(creator),
+          _accessor(),
+          _has_accessor(false)
+    {
+        register_type_conversions();
+    }
+    
+    PropertyDefinition(std::string name, bool is_writable,
+                       PropertyAccessor<S> accessor) 
+        : _name(name), 
+          _id(_name),
+          _type(type_string_traits::type_to_string((S*)(nullptr))),
           _is_writable(is_writable),
-          _type(type_string_traits::type_to_string((S*)(nullptr)))
+          _accessor(accessor),
+          _has_accessor(true)
     {
+        register_type_conversions();
     }
 
     const std::string& get_type() const override
     {
         return _type; 
     }
+    std::type_index get_type_index() const override
+    {
+        return typeid(S);
+    }
     const std::string& get_name() const override
     {
         return _name;
     }
+    PropertyId get_id() const override
+    {
+        return _id;
+    }
    
     std::unique_ptr<IProperty> create(
         INotifyPropertyChanged* owner) const override
     {
-        return std::unique_ptr<IProperty>(_creator(owner, get_name()));
+        if (_has_accessor)
+        {
+            return std::unique_ptr<IProperty>(
+                new AccessorProperty<S>(owner, _id, _accessor));
+        }
+        return std::unique_ptr<IProperty>(_creator(owner, _id));
     }
     
     bool is_writable() const override
@@ -292,11 +713,29 @@ public:
         return _is_writable;
     }
     
+    const void* get_accessor() const override
+    {
+        return _has_accessor ? &_accessor : nullptr;
+    }
+    AccessorCopy get_accessor_copy() const override
+    {
+        return &copy_with_accessors<S>;
+    }
+    
 private:
+    static void register_type_conversions()
+    {
+        static auto registered = (register_conversions((S*)(nullptr)), true);
+        (void)registered;
+    }
+
     std::string _name;
+    PropertyId _id;
     std::string _type;
     bool _is_writable;
     PropertyCreator _creator;
+    PropertyAccessor<S> _accessor;
+    bool _has_accessor;
 };
 
 class IMultitype : public IVirtualBase
@@ -322,7 +761,7 @@ class InlineVariable : public PropertyBase<T>
 {
 public:
     InlineVariable() 
-        : PropertyBase<T>((INotifyPropertyChanged*)(nullptr), ""),
+        : PropertyBase<T>((INotifyPropertyChanged*)(nullptr), PropertyId()),
           _val()
     {}
     
@@ -446,8 +885,8 @@ class FieldProperty : public PropertyBase<S>
 {
 public:
     FieldProperty(INotifyPropertyChanged* owner,
-                  std::string name, S T::* field) 
-        : PropertyBase<S>(owner, name), _field(field)
+                  PropertyId id, S T::* field) 
+        : PropertyBase<S>(owner, id), _field(field)
     {
         _t = static_cast<T*>(owner);
     }
@@ -474,8 +913,8 @@ public:
     typedef S (T::*TGetter)() const;
 
     ReadOnlyProperty(INotifyPropertyChanged* owner,
-                     std::string name, TGetter getter) 
-        : PropertyBase<S>(owner, name), _getter(getter)
+                     PropertyId id, TGetter getter) 
+        : PropertyBase<S>(owner, id), _getter(getter)
     {
         _t = static_cast<T*>(owner);
     }
@@ -503,8 +942,8 @@ public:
     typedef void (T::*TSetter)(S);
 
     ReadWriteProperty(INotifyPropertyChanged* owner,
-                      std::string name, TGetter getter, TSetter setter) 
-        : PropertyBase<S>(owner, name), _getter(getter), _setter(setter)
+                      PropertyId id, TGetter getter, TSetter setter) 
+        : PropertyBase<S>(owner, id), _getter(getter), _setter(setter)
     {
         _t = static_cast<T*>(owner);
     }
@@ -533,9 +972,9 @@ public:
     typedef std::function<void(INotifyPropertyChanged*,S)> TSetter;
 
     ReadWritePropertyLambda(INotifyPropertyChanged* owner,
-                            std::string name, TGetter getter, TSetter setter) 
-        : PropertyBase<S>(owner, name), _owner(owner),
-          _getter(getter), _setter(setter)
+                            PropertyId id, TGetter getter, TSetter setter) 
+        : PropertyBase<S>(owner, id), _getter(getter),
+          _setter(setter), _owner(owner)
     {
     }
     
@@ -559,15 +998,25 @@ private:
 #define DefineClass(T) using __Type = T;\
     return std::make_shared<TypeDefinitionBuilder<__Type>>(#T) 
     
-#define AddField(F) add(&__Type::F, #F)
+#define AddField(F) add_field<decltype(&__Type::F), &__Type::F>(#F)
 
-#define AddProperty(R, W) add(&__Type::R, &__Type::W, #R, #W)
+#define AddProperty(R, W) add_accessor<decltype(&__Type::R), &__Type::R,\
+                                       decltype(&__Type::W), &__Type::W>(#R, #W)
 
 #define ExtendClass(T, S) using __Type = T;\
-    auto base_ptr = TypeDefinition<S>::make();\
+    auto base_ptr = get_static_definition<S>();\
     auto base_builder = dynamic_cast<TypeDefinitionBuilder<S>*>(base_ptr.get());\
     return base_builder->extend<T>(#T)
 
+// Definition made by TypeDefinition<T>, built once per type and shared,
+// so that deriving from a type does not rebuild the base every time
+template<class T>
+std::shared_ptr<ITypeDefinition> get_static_definition()
+{
+    static auto definition = TypeDefinition<T>::make();
+    return definition;
+}
+
 
 template<class T, bool is_constructable>
 struct Ctor
@@ -594,8 +1043,14 @@ struct Ctor<T, false>
     }
 };
 
+// Every add appends to this builder and returns it, so a chain of
+// AddProperty calls builds the definition in place. Name lookups go through
+// a perfect hash: the seed of the hash is chosen so that no two property
+// names share a slot, and a lookup is one hash and one string compare
 template<class T>
-class TypeDefinitionBuilder : public ITypeDefinition
+class TypeDefinitionBuilder 
+    : public ITypeDefinition,
+      public std::enable_shared_from_this<TypeDefinitionBuilder<T>>
 {
 public:
     TypeDefinitionBuilder(std::string name) 
@@ -614,78 +1069,119 @@ public:
     
     const IPropertyDefinition* get_property(const std::string& name) const 
     {
-        auto it = _properties.find(name);
-        if (it != _properties.end())
+        auto index = find(name);
+        if (index >= 0)
         {
-            return it->second.get();
+            return _definitions[index].get();
         }
         throw std::runtime_error(str() << "Property " << name << " not found!");
     }
     IPropertyDefinition* get_property(const std::string& name)
     {
-        auto it = _properties.find(name);
-        if (it == _properties.end()) return nullptr;
-        return it->second.get();
+        auto index = find(name);
+        if (index < 0) return nullptr;
+        return _definitions[index].get();
     }
     const std::vector<std::string> get_property_names() const
     {
         return _property_names;
     }
     
-    void assign_fields(std::vector<std::string> property_names,
-                       std::map<std::string, 
-                       std::shared_ptr<IPropertyDefinition>> properties)
-    {
-        _property_names = property_names;
-        _properties = properties;
-    }
-    
     template<class S>
     std::shared_ptr<TypeDefinitionBuilder<S>> extend(const char* name) const
     {
         auto result = std::make_shared<TypeDefinitionBuilder<S>>(name);
-        result->assign_fields(_property_names, _properties);
+        result->_property_names = _property_names;
+        result->_definitions = _definitions;
         return result;
     }
     
+    // Fields and getter/setter pairs passed as template arguments,
+    // so their accessors call them directly
+    template<class F, F f>
+    std::shared_ptr<TypeDefinitionBuilder<T>> add_field(const char* name)
+    {
+        return add_field<F, f>(name, std::is_member_function_pointer<F>());
+    }
+    
+    template<class F, F f>
+    std::shared_ptr<TypeDefinitionBuilder<T>> add_field(const char* name,
+                                                        std::false_type)
+    {
+        typedef typename member_traits<F>::value_type S;
+        
+        PropertyAccessor<S> accessor { &get_field<T, S, F, f>, 
+                                       &set_field<T, S, F, f> };
+        return add_definition(std::make_shared<PropertyDefinition<S>>(
+            name, true, accessor));
+    }
+    
+    // a getter alone makes a read-only property
+    template<class F, F f>
+    std::shared_ptr<TypeDefinitionBuilder<T>> add_field(const char* name,
+                                                        std::true_type)
+    {
+        typedef typename member_traits<F>::value_type S;
+        
+        auto name_str = remove_prefix("get_", name);
+        if (name_str == name) name_str = remove_prefix("is_", name);
+        
+        PropertyAccessor<S> accessor { &call_getter<T, S, F, f>, nullptr };
+        return add_definition(std::make_shared<PropertyDefinition<S>>(
+            name_str, false, accessor));
+    }
+    
+    template<class R, R r, class W, W w>
+    std::shared_ptr<TypeDefinitionBuilder<T>> add_accessor(const char* rname,
+                                                           const char* wname)
+    {
+        typedef typename member_traits<R>::value_type S;
+        
+        auto name_str = remove_prefix("get_", rname);
+        if (name_str == rname) name_str = remove_prefix("is_", rname);
+        if (name_str != remove_prefix("set_", wname))
+        {
+            throw std::runtime_error(str() << "Inconsistent naming for property " 
+                    << name_str << "!");
+        }
+        
+        PropertyAccessor<S> accessor { &call_getter<T, S, R, r>, 
+                                       &call_setter<T, S, W, w> };
+        return add_definition(std::make_shared<PropertyDefinition<S>>(
+            name_str, true, accessor));
+    }
+    
     template<class S>
-    std::shared_ptr<TypeDefinitionBuilder<T>> add(S T::* f, const char* name) const
+    std::shared_ptr<TypeDefinitionBuilder<T>> add(S T::* f, const char* name)
     {
-        auto result = std::make_shared<TypeDefinitionBuilder<T>>(*this);
         std::string name_str(name);
-        result->_property_names.push_back(name_str);
         auto ptr = std::make_shared<PropertyDefinition<S>>(name_str, true,
         [f](auto owner, auto name){
             return new FieldProperty<T, S>(owner, name, f);
         });
-        result->_properties[name] = ptr;
-        return result;
+        return add_definition(ptr);
     }
     
     template<class S>
-    std::shared_ptr<TypeDefinitionBuilder<T>> add(S (T::*f)() const, const char* name) const
+    std::shared_ptr<TypeDefinitionBuilder<T>> add(S (T::*f)() const, const char* name)
     {
-        auto result = std::make_shared<TypeDefinitionBuilder<T>>(*this);
         auto name_str = remove_prefix("get_", name);
         if (name_str == name) name_str = remove_prefix("is_", name);
-        result->_property_names.push_back(name_str);
 
         auto ptr = std::make_shared<PropertyDefinition<S>>(name_str, false,
         [f](auto owner, auto name){
             return new ReadOnlyProperty<T, S>(owner, name, f);
         });
         
-        result->_properties[name_str] = ptr;
-        return result;
+        return add_definition(ptr);
     }
     
     template<class S>
     std::shared_ptr<TypeDefinitionBuilder<T>> add(const S& (T::*r)() const, 
                                                void (T::*w)(S), 
                                                const char* rname,
-                                               const char* wname) const
+                                               const char* wname)
     {
-        auto result = std::make_shared<TypeDefinitionBuilder<T>>(*this);
         auto name_str = remove_prefix("get_", rname);
         if (name_str == rname) name_str = remove_prefix("is_", rname);
         if (name_str != remove_prefix("set_", wname))
@@ -693,7 +1189,6 @@ public:
             throw std::runtime_error(str() << "Inconsistent naming for property " 
                     << name_str << "!");
         }
-        result->_property_names.push_back(name_str);
         
         auto rf = [r](auto owner) -> S {
             auto t = static_cast<T*>(owner);
@@ -708,17 +1203,15 @@ public:
         [rf, wf](auto owner, auto name){
             return new ReadWritePropertyLambda<T, S>(owner, name, rf, wf);
         });
-        result->_properties[name_str] = ptr;
-        return result;
+        return add_definition(ptr);
     }
     
     template<class S>
     std::shared_ptr<TypeDefinitionBuilder<T>> add(const S& (T::*r)() const, 
                                                void (T::*w)(const S&), 
                                                const char* rname,
-                                               const char* wname) const
+                                               const char* wname)
     {
-        auto result = std::make_shared<TypeDefinitionBuilder<T>>(*this);
         auto name_str = remove_prefix("get_", rname);
         if (name_str == rname) name_str = remove_prefix("is_", rname);
         if (name_str != remove_prefix("set_", wname))
@@ -726,7 +1219,6 @@ public:
             throw std::runtime_error(str() << "Inconsistent naming for property " 
                     << name_str << "!");
         }
-        result->_property_names.push_back(name_str);
         
         auto rf = [r](auto owner) -> S {
             auto t = static_cast<T*>(owner);
@@ -741,17 +1233,15 @@ public:
         [rf, wf](auto owner, auto name){
             return new ReadWritePropertyLambda<T, S>(owner, name, rf, wf);
         });
-        result->_properties[name_str] = ptr;
-        return result;
+        return add_definition(ptr);
     }
     
     template<class S>
     std::shared_ptr<TypeDefinitionBuilder<T>> add(S (T::*r)() const, 
                                                void (T::*w)(const S&), 
                                                const char* rname,
-                                               const char* wname) const
+                                               const char* wname)
     {
-        auto result = std::make_shared<TypeDefinitionBuilder<T>>(*this);
         auto name_str = remove_prefix("get_", rname);
         if (name_str == rname) name_str = remove_prefix("is_", rname);
         if (name_str != remove_prefix("set_", wname))
@@ -759,7 +1249,6 @@ public:
             throw std::runtime_error(str() << "Inconsistent naming for property " 
                     << name_str << "!");
         }
-        result->_property_names.push_back(name_str);
         
         auto rf = [r](auto owner) -> S {
             auto t = static_cast<T*>(owner);
@@ -774,17 +1263,14 @@ public:
         [rf, wf](auto owner, auto name){
             return new ReadWritePropertyLambda<T, S>(owner, name, rf, wf);
         });
-        result->_properties[name_str] = ptr;
-        return result;
+        return add_definition(ptr);
     }
     
     template<class S>
-    std::shared_ptr<TypeDefinitionBuilder<T>> add(const S& (T::*f)() const, const char* name) const
+    std::shared_ptr<TypeDefinitionBuilder<T>> add(const S& (T::*f)() const, const char* name)
     {
-        auto result = std::make_shared<TypeDefinitionBuilder<T>>(*this);
         auto name_str = remove_prefix("get_", name);
         if (name_str == name) name_str = remove_prefix("is_", name);
-        result->_property_names.push_back(name_str);
         
         auto rf = [f](auto owner) -> S {
             auto t = static_cast<T*>(owner);
@@ -798,17 +1284,15 @@ public:
         [rf, wf](auto owner, auto name){
             return new ReadWritePropertyLambda<T, S>(owner, name, rf, wf);
         });
-        result->_properties[name_str] = ptr;
-        return result;
+        return add_definition(ptr);
     }
     
     template<class S>
     std::shared_ptr<TypeDefinitionBuilder<T>> add(S (T::*r)() const, 
                                                void (T::*w)(S), 
                                                const char* rname,
-                                               const char* wname) const
+                                               const char* wname)
     {
-        auto result = std::make_shared<TypeDefinitionBuilder<T>>(*this);
         auto name_str = remove_prefix("get_", rname);
         if (name_str == rname) name_str = remove_prefix("is_", rname);
         if (name_str != remove_prefix("set_", wname))
@@ -816,19 +1300,95 @@ public:
             throw std::runtime_error(str() << "Inconsistent naming for property " 
                     << name_str << "!");
         }
-        result->_property_names.push_back(name_str);
         auto ptr = std::make_shared<PropertyDefinition<S>>(name_str, true,
         [r, w](auto owner, auto name){
             return new ReadWriteProperty<T, S>(owner, name, r, w);
         });
-        result->_properties[name_str] = ptr;
-        return result;
+        return add_definition(ptr);
     }
    
 private:
-    std::vector<std::string> _property_names;
-    std::map<std::string, std::shared_ptr<IPropertyDefinition>> _properties;
+    template<class S> friend class TypeDefinitionBuilder;
+    
+    std::shared_ptr<TypeDefinitionBuilder<T>> add_definition(
+        std::shared_ptr<IPropertyDefinition> definition)
+    {
+        // a derived class can redefine a property of its base
+        auto& name = definition->get_name();
+        auto it = std::find(_property_names.begin(), _property_names.end(), name);
+        if (it != _property_names.end())
+        {
+            _definitions[it - _property_names.begin()] = definition;
+        }
+        else
+        {
+            _property_names.push_back(name);
+            _definitions.push_back(definition);
+        }
+        _lookup_ready = false;
+        return this->shared_from_this();
+    }
+    
+    static unsigned hash(const std::string& name, unsigned seed)
+    {
+        auto h = 2166136261u ^ seed;
+        for (auto c : name)
+        {
+            h ^= (unsigned char)c;
+            h *= 16777619u;
+        }
+        return h;
+    }
+    
+    int find(const std::string& name) const
+    {
+        if (!_lookup_ready) build_lookup();
+        
+        auto index = _slots[hash(name, _seed) & (_slots.size() - 1)];
+        if (index < 0 || _property_names[index] != name) return -1;
+        return index;
+    }
+    
+    // built on the first lookup, once all the properties are added
+    void build_lookup() const
+    {
+        std::lock_guard<std::mutex> lock(_lookup_lock);
+        if (_lookup_ready) return;
+        
+        size_t size = 1;
+        while (size < _property_names.size() * 2) size *= 2;
+        
+        std::vector<int> slots;
+        auto seed = 0u;
+        while (true)
+        {
+            slots.assign(size, -1);
+            auto collision = false;
+            for (size_t i = 0; !collision && i < _property_names.size(); i++)
+            {
+                auto& slot = slots[hash(_property_names[i], seed) & (size - 1)];
+                if (slot >= 0) collision = true;
+                else slot = i;
+            }
+            if (!collision) break;
+            
+            // a few seeds for every table size before giving it more room
+            if (++seed % 32 == 0) size *= 2;
+        }
+        
+        _slots = std::move(slots);
+        _seed = seed;
+        _lookup_ready = true;
+    }
+    
     std::string _name;
+    std::vector<std::string> _property_names;
+    std::vector<std::shared_ptr<IPropertyDefinition>> _definitions;
+    
+    mutable std::vector<int> _slots;
+    mutable unsigned _seed = 0;
+    mutable std::atomic<bool> _lookup_ready { false };
+    mutable std::mutex _lookup_lock;
 };
 
 enum class BindingMode
@@ -844,6 +1404,11 @@ public:
     void a_to_b();
     void b_to_a();
     
+    Binding(std::shared_ptr<TypeFactory> factory,
+            INotifyPropertyChanged* a, PropertyId a_prop,
+            INotifyPropertyChanged* b, PropertyId b_prop,
+            BindingMode mode,
+            std::shared_ptr<ITypeConverter> converter = nullptr);
     Binding(std::shared_ptr<TypeFactory> factory,
             INotifyPropertyChanged* a, std::string a_prop,
             INotifyPropertyChanged* b, std::string b_prop,
@@ -852,26 +1417,90 @@ public:
             
     virtual ~Binding();
     
+    // Built on demand, for errors and diagnostics
+    std::string describe() const;
+    
+protected:
+    // Points the b end at another object, or detaches it when nullptr
+    // What was resolved from the type of b is kept while it stays the same
+    void set_b(INotifyPropertyChanged* b);
+    
+    const std::shared_ptr<TypeFactory>& get_factory() const { return _factory; }
+    
 private:
+    void resolve_b();
+    
     bool _is_direct;
     std::shared_ptr<ITypeDefinition> _a_dc;
     std::shared_ptr<ITypeDefinition> _b_dc;
     std::unique_ptr<IProperty> _a_prop_ptr;
     std::unique_ptr<IProperty> _b_prop_ptr;
-    IPropertyDefinition* _a_prop_def;
-    IPropertyDefinition* _b_prop_def;
-    ICopyable* _direct_a;
-    ICopyable* _direct_b;
-    INotifyPropertyChanged* _a;
-    INotifyPropertyChanged* _b;
-    std::string _a_prop;
-    std::string _b_prop;
+    IPropertyDefinition* _a_prop_def = nullptr;
+    IPropertyDefinition* _b_prop_def = nullptr;
+    ICopyable* _direct_a = nullptr;
+    ICopyable* _direct_b = nullptr;
+    INotifyPropertyChanged* _a = nullptr;
+    INotifyPropertyChanged* _b = nullptr;
+    PropertyId _a_prop;
+    PropertyId _b_prop;
+    BindingMode _mode;
     bool _skip_a = false;
     bool _skip_b = false;
 
+    AccessorCopy _accessor_copy = nullptr;
+    const void* _a_accessor = nullptr;
+    const void* _b_accessor = nullptr;
+    ConversionRegistry::CopyFunction _copy_a_to_b = nullptr;
+    ConversionRegistry::CopyFunction _copy_b_to_a = nullptr;
+
     std::shared_ptr<ITypeConverter> _converter;
     std::unique_ptr<IMultitype> _converter_state;
     bool _converter_direction;
+    int _a_slot;
+    int _b_slot;
     std::shared_ptr<TypeFactory> _factory;
-    std::string _id;
+};
+
+// Binding to the property at the end of a path of objects, b.x.y.prop
+// Every object along the path is watched for a change of the next segment
+// and only the part of the path after the change is re-targeted. The chain
+// is built once, and nothing is looked up again while the objects that
+// come and go keep the same types
+class PathBinding : public Binding
+{
+public:
+    PathBinding(std::shared_ptr<TypeFactory> factory,
+                INotifyPropertyChanged* a, PropertyId a_prop,
+                INotifyPropertyChanged* b, 
+                const std::vector<PropertyId>& path,
+                BindingMode mode,
+                std::shared_ptr<ITypeConverter> converter = nullptr);
+    PathBinding(std::shared_ptr<TypeFactory> factory,
+                INotifyPropertyChanged* a, std::string a_prop,
+                INotifyPropertyChanged* b, 
+                const std::vector<PropertyId>& path,
+                BindingMode mode,
+                std::shared_ptr<ITypeConverter> converter = nullptr);
+    
+    ~PathBinding();
+    
+private:
+    typedef PropertyAccessor<std::shared_ptr<INotifyPropertyChanged>> ObjectAccessor;
+    
+    struct Segment
+    {
+        PropertyId id;
+        INotifyPropertyChanged* object = nullptr;
+        std::shared_ptr<ITypeDefinition> type;
+        const IPropertyDefinition* def = nullptr;
+        const ObjectAccessor* accessor = nullptr;
+        // keeps the next object of the path alive
+        std::shared_ptr<INotifyPropertyChanged> value;
+    };
+    
+    void retarget(int level, INotifyPropertyChanged* object);
+    void update(int level);
+    void release();
+    
+    std::vector<Segment> _segments;
 };
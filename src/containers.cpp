@@ -1,4 +1,10 @@
 #include "containers.h"
+#include "adaptors.h"
+#include "flat2d.h"
+#include "font.h"
+#include "parallel.h"
+
+#include <cassert>
 
 #include "../easyloggingpp/easylogging++.h"
 
@@ -107,38 +113,47 @@ void outline(const Rect& r, const Color3& c)
     glPopAttrib(); */
 }
 
-void StackPanel::update_mouse_position(Int2 cursor)
+IVisualElement* Container::hit_test(Int2 cursor) const
 {
-    auto accessors = get_accessors(_orientation);
-    auto ifield = accessors.ifield;
-    
-    auto sum = get_arrangement().position.*ifield;
+    auto& rects = get_arranged_rects();
+    auto& elements = get_elements();
+    auto count = std::min(rects.size(), elements.size());
     
-    bool found = false;
-    for (auto& p : get_elements()) {
-        auto new_origin = calc_new_layout(p, _orientation,
-                                          get_arrangement(),
-                                          _sizes[p],
-                                          _size_cache,
-                                          sum, false);
-
-        if (contains(new_origin, cursor))
-        {
-            if (get_focused_child() != p)
-            {
-                set_focused_child(p);
-            }
-            if (!p->is_focused()) p->set_focused(true);
-            p->update_mouse_position(cursor);
-            found = true;
-        }
-        else
-        {
-            if (p->is_focused()) p->set_focused(false);
-        }
+    // later children are rendered on top, so they win
+    for (auto i = (int)count - 1; i >= 0; i--)
+    {
+        if (contains(rects[i], cursor)) return elements[i];
     }
+    return nullptr;
+}
+
+IVisualElement* StackPanel::hit_test(Int2 cursor) const
+{
+    auto ifield = get_accessors(_orientation).ifield;
     
-    if (!found) set_focused_child(nullptr);
+    auto& rects = get_arranged_rects();
+    auto& elements = get_elements();
+    auto count = std::min(rects.size(), elements.size());
+    
+    // children are laid out one after another along the orientation,
+    // so the candidate can be found with a binary search
+    auto end = rects.begin() + count;
+    auto it = upper_bound(rects.begin(), end, cursor.*ifield,
+        [ifield](int x, const Rect& r) { return x < r.position.*ifield; });
+    
+    // rects are inclusive, so walk back over the ones touching the cursor
+    for (auto i = (int)(it - rects.begin()) - 1; i >= 0; i--)
+    {
+        auto& r = rects[i];
+        if (r.position.*ifield + r.size.*ifield < cursor.*ifield) break;
+        if (contains(r, cursor)) return elements[i];
+    }
+    return nullptr;
+}
+
+void StackPanel::update_mouse_position(Int2 cursor)
+{
+    update_hover(hit_test(cursor), cursor);
 }
 
 void Container::add_item(shared_ptr<INotifyPropertyChanged> item)
@@ -178,11 +193,18 @@ SizeMap StackPanel::calc_sizes(Orientation orientation,
     auto ifield = accessors.ifield;
     auto iother = accessors.iother;
 
+    // siblings measure independently of each other,
+    // so this is the part worth spreading over threads
+    vector<Size2> measured(content.size());
+    ParallelLayout::for_each(content.size(), [&](int i) {
+        measured[i] = content[i]->get_size();
+    });
+
     // first, scan items, map the "greedy" ones wanting relative portion
-    vector<IVisualElement*> greedy;
-    for (auto& p : content) {
-        auto p_rect = p->arrange(arrangement);
-        auto p_size = p->get_size();
+    vector<int> greedy;
+    for (size_t i = 0; i < content.size(); i++) {
+        auto p = content[i];
+        auto& p_size = measured[i];
         //LOG(INFO) << "child " << p->get_name() << " asked size " << p_size;
 
         if ((p_size.*field).is_const()) {
@@ -191,19 +213,19 @@ SizeMap StackPanel::calc_sizes(Orientation orientation,
             sizes[p].first = pixels;
             sizes[p].second = p_size.*other;
         } else {
-            greedy.push_back(p);
+            greedy.push_back(i);
         }
     }
 
     auto rest = max(arrangement.size.*ifield - sum, 0);
     float total_parts = 0.0001;
-    for (auto ptr : greedy) {
-        total_parts += (ptr->get_size().*field).get_percents();
+    for (auto i : greedy) {
+        total_parts += (measured[i].*field).get_percents();
     }
-    for (auto ptr : greedy) {
-        auto f = ((ptr->get_size().*field).get_percents() / total_parts);
-        sizes[ptr].first = (int) (rest * f);
-        sizes[ptr].second = ptr->get_size().*other;
+    for (auto i : greedy) {
+        auto f = ((measured[i].*field).get_percents() / total_parts);
+        sizes[content[i]].first = (int) (rest * f);
+        sizes[content[i]].second = measured[i].*other;
     }
 
     return sizes;
@@ -232,12 +254,10 @@ Size2 StackPanel::get_intrinsic_size() const
 void StackPanel::render(const Rect& origin)
 {
     auto accessors = get_accessors(_orientation);
-    auto field  = accessors.field;
-    auto other  = accessors.other;
     auto ifield = accessors.ifield;
-    auto iother = accessors.iother;
 
-    if (update_layout(origin))
+    auto layout_changed = update_layout(origin);
+    if (layout_changed || _render_rects.size() != get_elements().size())
     {
         _sizes = calc_global_sizes(get_arrangement());
         
@@ -250,49 +270,132 @@ void StackPanel::render(const Rect& origin)
                 
             _size_cache[kvp.first] = ui->get_size();
         }
+        
+        auto& arranged = arranged_rects();
+        arranged.clear();
+        _render_rects.clear();
+        
+        auto sum = get_arrangement().position.*ifield;
+        auto arranged_sum = sum;
+        for (auto& p : get_elements()) {
+            _render_rects.push_back(calc_new_layout(p, _orientation,
+                                    get_arrangement(),
+                                    _sizes[p],
+                                    _size_cache,
+                                    sum));
+            arranged.push_back(calc_new_layout(p, _orientation,
+                               get_arrangement(),
+                               _sizes[p],
+                               _size_cache,
+                               arranged_sum, false));
+        }
     }
 
-    auto sum = get_arrangement().position.*ifield;
-    for (auto& p : get_elements()) {
-        auto new_origin = calc_new_layout(p, _orientation,
-                                  get_arrangement(),
-                                  _sizes[p],
-                                  _size_cache,
-                                  sum);
-
-        p->render(new_origin);
+    auto viewport = get_render_context().viewport;
+    auto& elements = get_elements();
+    for (size_t i = 0; i < elements.size(); i++) {
+        if (viewport && !intersects(_render_rects[i], *viewport)) continue;
+        elements[i]->render(_render_rects[i]);
     }
     
-    sum = get_arrangement().position.*ifield;
-    for (auto& p : get_elements()) {
-        auto new_origin = calc_new_layout(p, _orientation,
-                                  get_arrangement(),
-                                  _sizes[p],
-                                  _size_cache,
-                                  sum, false);
-        if (p->is_focused())
-            outline(new_origin, {1.0f, 1.0f, 1.0f});
+    auto& arranged = get_arranged_rects();
+    for (size_t i = 0; i < elements.size(); i++) {
+        if (elements[i]->is_focused())
+            outline(arranged[i], {1.0f, 1.0f, 1.0f});
     }
 }
 
 SimpleSizeMap Panel::calc_size_map(const VisualElements& content,
                                    const Rect& arrangement)
 {
+    vector<Int2> measured(content.size());
+    ParallelLayout::for_each(content.size(), [&](int i) {
+        measured[i] = content[i]->arrange(arrangement).size;
+    });
+    
     SimpleSizeMap map;
-    for (auto& p : content)
+    for (size_t i = 0; i < content.size(); i++)
     {
-        map[p] = p->arrange(arrangement).size;
+        map[content[i]] = measured[i];
     }
     return map;
 }
 
 void Panel::render(const Rect& origin)
 {
-    for (auto& p : get_elements()) {
-        p->render(origin);
+    auto layout_changed = update_layout(origin);
+    auto& arranged = arranged_rects();
+    if (layout_changed || arranged.size() != get_elements().size())
+    {
+        auto& elements = get_elements();
+        arranged.resize(elements.size());
+        ParallelLayout::for_each(elements.size(), [&](int i) {
+            arranged[i] = elements[i]->arrange(origin);
+        });
+        update_index();
+    }
+
+    auto viewport = get_render_context().viewport;
+    auto& elements = get_elements();
+    for (size_t i = 0; i < elements.size(); i++) {
+        if (viewport && !intersects(arranged[i], *viewport)) continue;
+        elements[i]->render(origin);
     }
 }
 
+void Panel::update_index()
+{
+    if (!_indexed) return;
+    
+    auto& arranged = get_arranged_rects();
+    for (auto i = 0; i < (int)arranged.size(); i++)
+    {
+        // only children that actually moved are re-inserted
+        _index.update(i, arranged[i]);
+    }
+    for (auto i = (int)arranged.size(); _index.contains_id(i); i++)
+    {
+        _index.remove(i);
+    }
+}
+
+IVisualElement* Panel::hit_test(Int2 cursor) const
+{
+    if (!_indexed) return Container::hit_test(cursor);
+    
+    auto id = _index.query_point(cursor);
+    if (id < 0 || id >= (int)get_elements().size()) return nullptr;
+    return get_elements()[id];
+}
+
+VisualElements Panel::query(const Rect& rect) const
+{
+    VisualElements result;
+    auto& elements = get_elements();
+    auto& arranged = get_arranged_rects();
+    
+    if (_indexed)
+    {
+        for (auto id : _index.query_rect(rect))
+        {
+            if (id < (int)elements.size()) result.push_back(elements[id]);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < arranged.size() && i < elements.size(); i++)
+        {
+            if (intersects(arranged[i], rect)) result.push_back(elements[i]);
+        }
+    }
+    return result;
+}
+
+void Panel::update_mouse_position(Int2 cursor)
+{
+    update_hover(hit_test(cursor), cursor);
+}
+
 Size2 Panel::get_intrinsic_size() const
 {
     auto sizes = calc_size_map(get_elements(), { { 0, 0 }, { 0, 0 } });
@@ -309,18 +412,95 @@ Size2 Panel::get_intrinsic_size() const
     return { Size(max_x), Size(max_y) };
 }
 
+// Pages come wrapped in adaptors, the container is what knows about changes
+const Container* unwrap_container(const IVisualElement* element)
+{
+    auto adaptor = dynamic_cast<const ElementAdaptor*>(element);
+    while (adaptor)
+    {
+        element = adaptor->get_element();
+        adaptor = dynamic_cast<const ElementAdaptor*>(element);
+    }
+    return dynamic_cast<const Container*>(element);
+}
+
 void PageView::render(const Rect& origin)
 {
-    get_focused_child()->render(origin);
+    auto page = get_focused_child();
+    if (!page) return;
+    
+    remember_page(page);
+    auto layout_changed = update_layout(origin);
+    _shown_size = get_size();
+    _shown = true;
+    
+    // unless its layout was invalidated, the page renders
+    // straight from the arrangement it had when last shown
+    page->render(origin);
+    
+    if (_premeasure && !layout_changed) premeasure_neighbours();
 }
 
 Size2 PageView::get_intrinsic_size() const
 {
     if (get_focused_child())
-        return get_focused_child()->get_intrinsic_size();
+        return measure_page(get_focused_child());
     throw;
 }
 
+bool PageView::is_fresh(const IVisualElement* page) const
+{
+    // pages that are not containers can't tell when they change
+    auto container = unwrap_container(page);
+    auto state = _pages.find(page);
+    return container && state != _pages.end() &&
+           state->second.version == container->get_layout_version();
+}
+
+Size2 PageView::measure_page(const IVisualElement* page) const
+{
+    if (is_fresh(page)) return _pages.find(page)->second.size;
+    return page->get_intrinsic_size();
+}
+
+void PageView::remember_page(const IVisualElement* page)
+{
+    assert(!ParallelLayout::in_task());
+    if (is_fresh(page)) return;
+    
+    auto container = unwrap_container(page);
+    auto& state = _pages[page];
+    state.size = page->get_intrinsic_size();
+    state.version = container ? container->get_layout_version() : 0;
+}
+
+void PageView::premeasure_neighbours()
+{
+    auto& pages = get_elements();
+    auto it = find(pages.begin(), pages.end(), get_focused_child());
+    if (it == pages.end()) return;
+    
+    auto count = (int)pages.size();
+    auto index = (int)(it - pages.begin());
+    for (auto next : { (index + 1) % count, (index + count - 1) % count })
+    {
+        auto page = pages[next];
+        if (!is_fresh(page))
+        {
+            // at most one page per frame, to keep idle frames cheap
+            remember_page(page);
+            return;
+        }
+    }
+}
+
+void PageView::on_page_switch()
+{
+    // the new page keeps the arrangement it had when last shown,
+    // so the layout around us only changes if our own size does
+    if (!_shown || !(get_size() == _shown_size)) invalidate_layout();
+}
+
 void Grid::commit_line()
 {
     if (_current_line) {
@@ -338,41 +518,498 @@ void Grid::commit_line()
 SizeMap Grid::calc_sizes(const StackPanel* sender,
                          const Rect& arrangement) const
 {
-    map<const StackPanel*, SizeMap> maps;
-    auto max_length = 0;
-    for (auto& p : _lines)
+    lock_guard<mutex> lock(_columns_lock);
+    if (_columns_version != get_layout_version())
     {
-        auto map = p->calc_local_sizes(arrangement);
-        maps[p.get()] = map;
-        max_length = max(max_length, (int)map.size());
+        _columns.clear();
+        _columns_version = get_layout_version();
     }
     
-    vector<vector<int>> grid;
-    for (auto& p : _lines)
+    auto length = get_orientation() == Orientation::vertical 
+        ? arrangement.size.x : arrangement.size.y;
+    auto it = find_if(_columns.begin(), _columns.end(), 
+        [&](const ColumnSizes& c) { return c.length == length; });
+    if (it == _columns.end())
     {
-        vector<int> row(max_length, 0);
-        auto i = 0;
-        for (auto& kvp : maps[p.get()])
+        _columns.push_back(measure_columns(arrangement));
+        _columns.back().length = length;
+        it = _columns.end() - 1;
+    }
+    
+    // the line still being filled is not laid out yet
+    auto line = it->lines.find(sender);
+    if (line == it->lines.end()) return SizeMap();
+    return line->second;
+}
+
+Grid::ColumnSizes Grid::measure_columns(const Rect& arrangement) const
+{
+    // lines are measured independently, then merged in order
+    vector<SizeMap> line_sizes(_lines.size());
+    ParallelLayout::for_each(_lines.size(), [&](int i) {
+        line_sizes[i] = _lines[i]->calc_local_sizes(arrangement);
+    });
+    
+    // cells are matched by their position in the line
+    vector<int> widths;
+    for (size_t i = 0; i < _lines.size(); i++)
+    {
+        auto& cells = _lines[i]->get_elements();
+        if (widths.size() < cells.size()) widths.resize(cells.size(), 0);
+        for (size_t k = 0; k < cells.size(); k++)
+        {
+            widths[k] = max(widths[k], line_sizes[i][cells[k]].first);
+        }
+    }
+    
+    ColumnSizes columns;
+    for (size_t i = 0; i < _lines.size(); i++)
+    {
+        auto& cells = _lines[i]->get_elements();
+        for (size_t k = 0; k < cells.size(); k++)
         {
-            row[i++] = kvp.second.first;
+            line_sizes[i][cells[k]].first = widths[k];
         }
-        grid.push_back(row);
+        columns.lines.emplace(_lines[i].get(), move(line_sizes[i]));
+    }
+    return columns;
+}
+
+
+ListView::~ListView()
+{
+    if (_items) _items->unsubscribe_on_change(this);
+}
+
+void ListView::set_item_template(ItemTemplate item_template)
+{
+    _template = item_template;
+    _realized.clear();
+    _recycled.clear();
+    _hovered = nullptr;
+}
+
+void ListView::set_items(shared_ptr<INotifyPropertyChanged> items)
+{
+    if (_items) _items->unsubscribe_on_change(this);
+    
+    for (auto& item : _realized) recycle(item);
+    _realized.clear();
+    
+    _items = items;
+    _source = dynamic_cast<IItemsSource*>(items.get());
+    if (_items)
+    {
+        _items->subscribe_on_change(this, PropertyName("count"), [this](const char* prop_name){
+            reset_measurements();
+        });
     }
     
-    auto result = maps[sender];
+    _heights.clear();
+    reset_measurements();
+    fire_property_change(PropertyName("items"));
+}
+
+void ListView::reset_measurements()
+{
+    auto count = get_count();
+    _heights.resize(count, 0);
+    _measured_heights.reset(count);
+    _measured_counts.reset(count);
+    _measured_total = 0;
+    _measured = 0;
     
-    auto _index = 0;
-    for (auto& kvp : result)
+    for (auto i = 0; i < count; i++)
     {
-        auto max = 0;
-        for (auto j = 0; j < grid.size(); j++)
+        if (_heights[i])
         {
-            max = std::max(grid[j][_index], max);
+            _measured_heights.add(i, _heights[i]);
+            _measured_counts.add(i, 1);
+            _measured_total += _heights[i];
+            _measured++;
         }
-        kvp.second.first = max;
-        _index++;
     }
+}
+
+void ListView::measure(int index, int height)
+{
+    auto& current = _heights[index];
+    if (current == height) return;
     
-    return result;
+    if (current)
+    {
+        _measured_heights.add(index, height - current);
+        _measured_total += height - current;
+    }
+    else
+    {
+        _measured_heights.add(index, height);
+        _measured_counts.add(index, 1);
+        _measured_total += height;
+        _measured++;
+    }
+    current = height;
+}
+
+int ListView::get_estimate() const
+{
+    if (_measured) return std::max(1, (int)(_measured_total / _measured));
+    return DEFAULT_ITEM_HEIGHT;
+}
+
+int ListView::get_offset(int index) const
+{
+    auto known = _measured_counts.prefix(index);
+    return _measured_heights.prefix(index) + (index - known) * get_estimate();
+}
+
+int ListView::index_at(int offset) const
+{
+    auto count = get_count();
+    if (!count) return 0;
+    
+    // first item ending after the offset
+    auto from = 0;
+    auto to = count - 1;
+    while (from < to)
+    {
+        auto mid = (from + to) / 2;
+        if (get_offset(mid + 1) > offset) to = mid;
+        else from = mid + 1;
+    }
+    return from;
+}
+
+ListView::RealizedItem ListView::realize(int index)
+{
+    RealizedItem item { index, nullptr, nullptr, { { 0, 0 }, { 0, 0 } } };
+    if (!_recycled.empty())
+    {
+        item = _recycled.back();
+        item.index = index;
+        _recycled.pop_back();
+    }
+    else if (_template)
+    {
+        item.obj = _template(this);
+        item.element = dynamic_cast<IVisualElement*>(item.obj.get());
+        if (item.element) item.element->set_render_context(get_render_context());
+    }
+    
+    if (item.element)
+    {
+        // rendered right after, so the bindings of the item template can't
+        // wait for the next flush of deferred changes
+        ChangeDispatcher::Synchronous synchronous;
+        item.element->set_data_context(_source->get_item(index));
+    }
+    return item;
+}
+
+void ListView::recycle(const RealizedItem& item)
+{
+    if (!item.element) return;
+    
+    if (item.element == _hovered)
+    {
+        _hovered->set_focused(false);
+        _hovered = nullptr;
+    }
+    _recycled.push_back(item);
+}
+
+void ListView::render(const Rect& origin)
+{
+    // realizing items builds and re-binds them, which must not
+    // invalidate the layout around the list
+    _in_render = true;
+    
+    auto rect = arrange(origin);
+    _viewport = rect.size.y;
+    
+    auto count = get_count();
+    if ((int)_heights.size() != count) reset_measurements();
+    
+    _scroll = clamp(_scroll, 0, std::max(0, get_extent() - _viewport));
+    
+    auto visible = index_at(_scroll);
+    auto first = std::max(0, visible - _overscan);
+    auto last = visible;
+    while (last < count && get_offset(last) < _scroll + _viewport) last++;
+    last = std::min(count, last + _overscan);
+    
+    // recycle whatever scrolled out of the realized range
+    vector<RealizedItem> kept;
+    for (auto& item : _realized)
+    {
+        if (item.index >= first && item.index < last) kept.push_back(item);
+        else recycle(item);
+    }
+    
+    _realized.clear();
+    auto it = kept.begin();
+    for (auto i = first; i < last; i++)
+    {
+        if (it != kept.end() && it->index == i) _realized.push_back(*it++);
+        else _realized.push_back(realize(i));
+    }
+    
+    auto viewport = get_render_context().viewport;
+    auto shown = viewport ? intersection(*viewport, rect) : rect;
+    
+    auto renderer = get_render_context().flat2d_renderer;
+    if (renderer) renderer->push_clip(rect);
+    
+    for (auto& item : _realized)
+    {
+        if (!item.element) continue;
+        
+        auto height = item.element->get_size().y.to_pixels(0);
+        if (height > 0) measure(item.index, height);
+        else height = get_estimate();
+        
+        auto y = rect.position.y + get_offset(item.index) - _scroll;
+        item.rect = { { rect.position.x, y }, { rect.size.x, height } };
+        
+        if (intersects(item.rect, shown)) item.element->render(item.rect);
+    }
+    _in_render = false;
+    
+    if (renderer) renderer->pop_clip();
+}
+
+void ListView::invalidate_layout()
+{
+    // items re-measure on every frame, so their changes
+    // never affect the layout around the list
+    if (_in_render) return;
+    ControlBase::invalidate_layout();
+}
+
+void ListView::update_mouse_position(Int2 cursor)
+{
+    IVisualElement* hit = nullptr;
+    for (auto& item : _realized)
+    {
+        if (item.element && contains(item.rect, cursor))
+        {
+            hit = item.element;
+            break;
+        }
+    }
+    
+    if (hit != _hovered)
+    {
+        if (_hovered) _hovered->set_focused(false);
+        _hovered = hit;
+    }
+    
+    if (hit)
+    {
+        if (!hit->is_focused()) hit->set_focused(true);
+        hit->update_mouse_position(cursor);
+    }
+}
+
+void ListView::update_mouse_state(MouseButton button, MouseState state)
+{
+    if (_hovered) _hovered->update_mouse_state(button, state);
+}
+
+void ListView::update_mouse_scroll(Int2 scroll)
+{
+    set_scroll_offset(_scroll - scroll.y * SCROLL_STEP);
+}
+
+void ListView::set_scroll_offset(int val)
+{
+    auto max_scroll = std::max(0, get_extent() - _viewport);
+    val = clamp(val, 0, max_scroll);
+    if (val != _scroll)
+    {
+        _scroll = val;
+        fire_property_change(PropertyName("scroll_offset"));
+    }
+}
+
+void ListView::set_focused(bool on)
+{
+    if (!on && _hovered)
+    {
+        _hovered->set_focused(false);
+        _hovered = nullptr;
+    }
+    ControlBase::set_focused(on);
 }
 
+void ListView::set_render_context(const RenderContext& context)
+{
+    ControlBase::set_render_context(context);
+    
+    for (auto& item : _realized)
+        if (item.element) item.element->set_render_context(context);
+    for (auto& item : _recycled)
+        if (item.element) item.element->set_render_context(context);
+}
+
+void ScrollViewer::add_item(std::shared_ptr<INotifyPropertyChanged> item)
+{
+    if (get_content())
+        throw std::runtime_error("ScrollViewer can only have a single content element!");
+    Container::add_item(item);
+}
+
+Int2 ScrollViewer::get_content_size(const Int2& viewport) const
+{
+    auto content = get_content();
+    if (!content) return { 0, 0 };
+    
+    auto size = content->get_size();
+    auto intrinsic = content->get_intrinsic_size();
+    auto resolve = [](const Size& size, const Size& intrinsic, int viewport) {
+        if (size.is_const()) return size.get_pixels();
+        return std::max(size.to_pixels(viewport), intrinsic.to_pixels(0));
+    };
+    return { resolve(size.x, intrinsic.x, viewport.x),
+             resolve(size.y, intrinsic.y, viewport.y) };
+}
+
+Size2 ScrollViewer::get_intrinsic_size() const
+{
+    auto size = get_content_size({ 0, 0 });
+    return { Size(std::min(size.x, DEFAULT_VIEWPORT)), 
+             Size(std::min(size.y, DEFAULT_VIEWPORT)) };
+}
+
+void ScrollViewer::render(const Rect& origin)
+{
+    auto content = get_content();
+    if (!content) return;
+    
+    // the content is never shrunk to the viewport, and once
+    // arranged, its rect stays the same no matter the offset
+    auto& arranged = arranged_rects();
+    if (update_layout(origin) || arranged.empty())
+    {
+        _rect = get_arrangement();
+        auto size = get_content_size(_rect.size);
+        _extent = { std::max(size.x, _rect.size.x), std::max(size.y, _rect.size.y) };
+        arranged = { { _rect.position, _extent } };
+        
+        set_horizontal_offset(_offset.x);
+        set_vertical_offset(_offset.y);
+    }
+    
+    auto& context = get_render_context();
+    auto outer = context.viewport ? intersection(*context.viewport, _rect) : _rect;
+    _visible = { outer.position + _offset, outer.size };
+    
+    auto flat2d_renderer = context.flat2d_renderer;
+    auto font_renderer = context.font_renderer;
+    Int2 flat2d_translation { 0, 0 }, font_translation { 0, 0 };
+    
+    if (flat2d_renderer)
+    {
+        flat2d_translation = flat2d_renderer->get_translation();
+        flat2d_renderer->push_clip(_rect);
+        flat2d_renderer->set_translation(flat2d_translation - _offset);
+    }
+    if (font_renderer)
+    {
+        font_translation = font_renderer->get_translation();
+        font_renderer->set_translation(font_translation - _offset);
+    }
+    
+    content->render(arranged.front());
+    
+    if (font_renderer) font_renderer->set_translation(font_translation);
+    if (flat2d_renderer)
+    {
+        flat2d_renderer->set_translation(flat2d_translation);
+        flat2d_renderer->pop_clip();
+    }
+}
+
+IVisualElement* ScrollViewer::hit_test(Int2 cursor) const
+{
+    return contains(_rect, cursor) ? get_content() : nullptr;
+}
+
+void ScrollViewer::update_mouse_position(Int2 cursor)
+{
+    _cursor = cursor;
+    
+    auto content = get_content();
+    if (!content) return;
+    
+    if (hit_test(cursor))
+    {
+        if (!content->is_focused()) content->set_focused(true);
+        content->update_mouse_position(cursor + _offset);
+    }
+    else if (content->is_focused())
+    {
+        content->set_focused(false);
+    }
+}
+
+void ScrollViewer::update_mouse_state(MouseButton button, MouseState state)
+{
+    auto content = get_content();
+    if (content && content->is_focused())
+        content->update_mouse_state(button, state);
+}
+
+void ScrollViewer::update_mouse_scroll(Int2 scroll)
+{
+    auto content = get_content();
+    if (!content) return;
+    
+    // let nested scrollable content have the wheel when there is nothing to scroll
+    if (_extent.x <= _rect.size.x && _extent.y <= _rect.size.y)
+    {
+        if (content->is_focused()) content->update_mouse_scroll(scroll);
+        return;
+    }
+    
+    set_horizontal_offset(_offset.x - scroll.x * SCROLL_STEP);
+    set_vertical_offset(_offset.y - scroll.y * SCROLL_STEP);
+    
+    // the content moved under the cursor
+    update_mouse_position(_cursor);
+}
+
+void ScrollViewer::set_render_context(const RenderContext& context)
+{
+    ControlBase::set_render_context(context);
+    
+    auto inner = context;
+    inner.viewport = &_visible;
+    for (auto& e : get_elements())
+    {
+        e->set_render_context(inner);
+    }
+}
+
+void ScrollViewer::set_horizontal_offset(int val)
+{
+    // before the first layout the extent is unknown, so nothing to clamp to
+    auto max_offset = get_arranged_rects().empty() ? val : _extent.x - _rect.size.x;
+    val = clamp(val, 0, std::max(0, max_offset));
+    if (val != _offset.x)
+    {
+        _offset.x = val;
+        fire_property_change(PropertyName("horizontal_offset"));
+    }
+}
+
+void ScrollViewer::set_vertical_offset(int val)
+{
+    auto max_offset = get_arranged_rects().empty() ? val : _extent.y - _rect.size.y;
+    val = clamp(val, 0, std::max(0, max_offset));
+    if (val != _offset.y)
+    {
+        _offset.y = val;
+        fire_property_change(PropertyName("vertical_offset"));
+    }
+}
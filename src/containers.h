@@ -1,5 +1,6 @@
 #pragma once
 #include "ui.h"
+#include "spatial.h"
 
 typedef std::unordered_map<INotifyPropertyChanged*, std::pair<int, Size>> SizeMap;
 typedef std::unordered_map<INotifyPropertyChanged*, Size2> ElementsSizeCache;
@@ -37,6 +38,7 @@ public:
     {
         if (_focused)
         {
+            if (!_focused->is_focused()) _focused->set_focused(true);
             _focused->update_mouse_position(cursor);
         }
     }
@@ -48,12 +50,26 @@ public:
             _focused->update_mouse_state(button, state);
         }
     }
+    
+    void update_mouse_scroll(Int2 scroll) override
+    {
+        if (_focused)
+        {
+            _focused->update_mouse_scroll(scroll);
+        }
+    }
 
     void invalidate_layout() override
     {
+        if (LayoutTransaction::enlist(this)) return;
         _origin = { { 0, 0 }, { 0, 0 } };
-        if (get_parent()) ControlBase::invalidate_layout();
+        _layout_version++;
+        if (get_parent()) invalidate_parent_layout();
     }
+    
+    // Changes every time the layout of this container
+    // or of anything inside of it is invalidated
+    unsigned get_layout_version() const { return _layout_version; }
 
     virtual void add_item(std::shared_ptr<INotifyPropertyChanged> item);
 
@@ -70,6 +86,12 @@ public:
     const VisualElements& get_elements() const { return _visual_elements; }
     const Rect& get_arrangement() const { return _arrangement; }
     
+    // Final rects of the children, as arranged during the last layout,
+    // indexed the same way as get_elements()
+    const std::vector<Rect>& get_arranged_rects() const { return _arranged_rects; }
+    
+    virtual IVisualElement* hit_test(Int2 cursor) const;
+    
     bool update_layout(const Rect& origin)
     {
         if (_origin == origin) return false;
@@ -80,6 +102,9 @@ public:
     }
     
     void set_focused_child(IVisualElement* focused) { 
+        // the hover path below the previous child is left
+        if (_focused != focused && _focused && _focused->is_focused())
+            _focused->set_focused(false);
         _focused = focused; 
         _on_focus_change();
     }
@@ -110,16 +135,35 @@ public:
         }
     }
     
+    // Hover is a single path from the root down, through the focused child
+    // of every container. Leaving takes the path below along, entering only
+    // marks this node, the next mouse move extends the path from here
     void set_focused(bool on) override
     {
-        for (auto& e : get_elements())
+        if (!on && _focused && _focused->is_focused())
         {
-            e->set_focused(on);
+            _focused->set_focused(false);
         }
         
         ControlBase::set_focused(on);
     }
 
+protected:
+    std::vector<Rect>& arranged_rects() { return _arranged_rects; }
+    
+    // Moves the hover path to the hit child, only the nodes
+    // entered or left on the way get notified
+    void update_hover(IVisualElement* hit, Int2 cursor)
+    {
+        if (hit != _focused) set_focused_child(hit);
+        
+        if (hit)
+        {
+            if (!hit->is_focused()) hit->set_focused(true);
+            hit->update_mouse_position(cursor);
+        }
+    }
+
 private:
     IVisualElement* _focused = nullptr;
 
@@ -127,6 +171,8 @@ private:
     VisualElements _visual_elements;
     Rect _origin;
     Rect _arrangement;
+    std::vector<Rect> _arranged_rects;
+    unsigned _layout_version = 0;
 
     std::function<void()> _on_items_change;
     std::function<void()> _on_focus_change;
@@ -152,6 +198,8 @@ public:
     
     void update_mouse_position(Int2 cursor) override;
     
+    IVisualElement* hit_test(Int2 cursor) const override;
+    
     static SizeMap calc_sizes(Orientation orientation,
                               const VisualElements& content,
                               const Rect& arrangement);
@@ -178,13 +226,14 @@ public:
     
     void set_orientation(Orientation val) { 
         _orientation = val; 
-        fire_property_change("orientation");
+        fire_property_change(PropertyName("orientation"));
     }
     Orientation get_orientation() const { return _orientation; }
 
 private:
     SizeMap _sizes;
     ElementsSizeCache _size_cache;
+    std::vector<Rect> _render_rects;
     ISizeCalculator* _resizer = nullptr;
     Orientation _orientation = Orientation::vertical;
 };
@@ -220,8 +269,32 @@ public:
 
     void render(const Rect& origin) override;
     
+    void update_mouse_position(Int2 cursor) override;
+    
+    IVisualElement* hit_test(Int2 cursor) const override;
+    
+    // Children intersecting the rect, ordered bottom to top
+    VisualElements query(const Rect& rect) const;
+    
+    // Maintain a spatial index over the arranged children,
+    // useful when there are many free-positioned children
+    void set_indexed(bool val) 
+    { 
+        _indexed = val;
+        _index.clear();
+        invalidate_layout();
+        fire_property_change(PropertyName("indexed"));
+    }
+    bool is_indexed() const { return _indexed; }
+    
     static SimpleSizeMap calc_size_map(const VisualElements& content,
                                        const Rect& arrangement);
+                                       
+private:
+    void update_index();
+
+    bool _indexed = false;
+    SpatialGrid _index;
 };
 
 template<>
@@ -229,7 +302,9 @@ struct TypeDefinition<Panel>
 {
     static std::shared_ptr<ITypeDefinition> make() 
     {
-        ExtendClass(Panel, ControlBase);
+        ExtendClass(Panel, ControlBase)
+             ->AddProperty(is_indexed, set_indexed)
+             ;
     }
 };
 
@@ -242,12 +317,12 @@ public:
              Alignment alignment)
         : Container(name, position, size, alignment)
     {
-        set_focus_change([this]() { invalidate_layout(); });
+        set_focus_change([this]() { on_page_switch(); });
     }
     
     PageView() 
     {
-        set_focus_change([this]() { invalidate_layout(); });
+        set_focus_change([this]() { on_page_switch(); });
     }
     
     const char* get_type() const override { return "PageView"; }
@@ -255,6 +330,35 @@ public:
     Size2 get_intrinsic_size() const override;
 
     void render(const Rect& origin) override;
+    
+    // Measure the pages next to the shown one during idle frames,
+    // so that switching to them doesn't need to measure anything
+    void set_premeasure(bool val)
+    {
+        _premeasure = val;
+        fire_property_change(PropertyName("premeasure"));
+    }
+    bool get_premeasure() const { return _premeasure; }
+    
+private:
+    struct PageState
+    {
+        unsigned version = 0;
+        Size2 size;
+    };
+    
+    // Measuring may run on the threads of the parallel layout, so it only
+    // reads the cache; it is filled by render and premeasure_neighbours
+    bool is_fresh(const IVisualElement* page) const;
+    Size2 measure_page(const IVisualElement* page) const;
+    void remember_page(const IVisualElement* page);
+    void premeasure_neighbours();
+    void on_page_switch();
+    
+    std::unordered_map<const IVisualElement*, PageState> _pages;
+    Size2 _shown_size;
+    bool _shown = false;
+    bool _premeasure = false;
 };
 
 template<>
@@ -262,7 +366,9 @@ struct TypeDefinition<PageView>
 {
     static std::shared_ptr<ITypeDefinition> make() 
     {
-        ExtendClass(PageView, ControlBase);
+        ExtendClass(PageView, ControlBase)
+             ->AddProperty(get_premeasure, set_premeasure)
+             ;
     }
 };
 
@@ -301,8 +407,24 @@ public:
                        const Rect& arrangement) const override;
 
 private:
+    // Sizes of every line, with each column as wide as its widest cell
+    struct ColumnSizes
+    {
+        // the lines only look at the length they are laid out along
+        int length;
+        std::unordered_map<const StackPanel*, SizeMap> lines;
+    };
+    ColumnSizes measure_columns(const Rect& arrangement) const;
+
     std::shared_ptr<StackPanel> _current_line;
     std::vector<std::shared_ptr<StackPanel>> _lines;
+    
+    // every line asks for the sizes of all of them, so they are measured
+    // once per layout version and line length. Lines may be measured
+    // concurrently, hence the lock
+    mutable std::mutex _columns_lock;
+    mutable unsigned _columns_version = 0;
+    mutable std::vector<ColumnSizes> _columns;
 };
 
 template<>
@@ -313,3 +435,219 @@ struct TypeDefinition<Grid>
         ExtendClass(Grid, StackPanel);
     }
 };
+
+// Fenwick tree, answering prefix sums in O(log n)
+class PrefixSumTree
+{
+public:
+    void reset(int size) { _tree.assign(size + 1, 0); }
+    int size() const { return (int)_tree.size() - 1; }
+    
+    void add(int index, int delta)
+    {
+        for (auto i = index + 1; i < (int)_tree.size(); i += i & (-i))
+            _tree[i] += delta;
+    }
+    
+    // Sum of the first count elements
+    long long prefix(int count) const
+    {
+        long long sum = 0;
+        for (auto i = count; i > 0; i -= i & (-i))
+            sum += _tree[i];
+        return sum;
+    }
+    
+private:
+    std::vector<long long> _tree;
+};
+
+typedef std::function<std::shared_ptr<INotifyPropertyChanged>(IVisualElement* parent)>
+        ItemTemplate;
+
+// Vertical list that only realizes the items in view
+// Item heights are measured once realized and estimated otherwise
+class ListView : public ControlBase
+{
+public:
+    ListView(std::string name,
+             const Size2& position,
+             const Size2& size,
+             Alignment alignment)
+        : ControlBase(name, position, size, alignment)
+    {}
+    
+    ListView() {}
+    ~ListView();
+    
+    const char* get_type() const override { return "ListView"; }
+    
+    // Items are only measured while they render, and their changes never
+    // reach the layout around the list, so without a size of its own the
+    // list gets a default viewport rather than one derived from them
+    Size2 get_intrinsic_size() const override 
+    { 
+        return { DEFAULT_VIEWPORT, DEFAULT_VIEWPORT }; 
+    }
+    
+    void render(const Rect& origin) override;
+    void invalidate_layout() override;
+    
+    void update_mouse_position(Int2 cursor) override;
+    void update_mouse_state(MouseButton button, MouseState state) override;
+    void update_mouse_scroll(Int2 scroll) override;
+    
+    void set_focused(bool on) override;
+    
+    void set_render_context(const RenderContext& context) override;
+    
+    void set_item_template(ItemTemplate item_template);
+    
+    void set_items(std::shared_ptr<INotifyPropertyChanged> items);
+    std::shared_ptr<INotifyPropertyChanged> get_items() const { return _items; }
+    
+    void set_overscan(int val) 
+    { 
+        _overscan = val; 
+        fire_property_change(PropertyName("overscan"));
+    }
+    int get_overscan() const { return _overscan; }
+    
+    void set_scroll_offset(int val);
+    int get_scroll_offset() const { return _scroll; }
+    
+    int get_extent() const { return get_offset(get_count()); }
+    int get_realized_count() const { return _realized.size(); }
+    
+private:
+    struct RealizedItem
+    {
+        int index;
+        std::shared_ptr<INotifyPropertyChanged> obj;
+        IVisualElement* element;
+        Rect rect;
+    };
+    
+    int get_count() const { return _source ? _source->get_count() : 0; }
+    int get_estimate() const;
+    int get_offset(int index) const;
+    int index_at(int offset) const;
+    
+    void reset_measurements();
+    void measure(int index, int height);
+    
+    RealizedItem realize(int index);
+    void recycle(const RealizedItem& item);
+    
+    std::shared_ptr<INotifyPropertyChanged> _items;
+    IItemsSource* _source = nullptr;
+    ItemTemplate _template;
+    
+    std::vector<RealizedItem> _realized;
+    std::vector<RealizedItem> _recycled;
+    IVisualElement* _hovered = nullptr;
+    
+    std::vector<int> _heights;
+    PrefixSumTree _measured_heights;
+    PrefixSumTree _measured_counts;
+    long long _measured_total = 0;
+    int _measured = 0;
+    
+    int _scroll = 0;
+    int _overscan = 2;
+    int _viewport = 0;
+    bool _in_render = false;
+    
+    const int DEFAULT_ITEM_HEIGHT = 20;
+    const int DEFAULT_VIEWPORT = 200;
+    const int SCROLL_STEP = 40;
+};
+
+template<>
+struct TypeDefinition<ListView>
+{
+    static std::shared_ptr<ITypeDefinition> make() 
+    {
+        ExtendClass(ListView, ControlBase)
+             ->AddProperty(get_items, set_items)
+             ->AddProperty(get_overscan, set_overscan)
+             ->AddProperty(get_scroll_offset, set_scroll_offset)
+             ->AddField(get_extent)
+             ;
+    }
+};
+
+// Shows a window into content that may be larger than itself
+// The content is measured and arranged once, scrolling only translates it
+// Its percentages resolve against the viewport, there being nothing else
+// to resolve them against, but it never gets less than its intrinsic size
+class ScrollViewer : public Container
+{
+public:
+    ScrollViewer(std::string name,
+                 const Size2& position,
+                 const Size2& size,
+                 Alignment alignment)
+        : Container(name, position, size, alignment)
+    {}
+    
+    ScrollViewer() {}
+    
+    const char* get_type() const override { return "ScrollViewer"; }
+    
+    // As large as the content, up to a default viewport past which it scrolls
+    Size2 get_intrinsic_size() const override;
+    
+    void add_item(std::shared_ptr<INotifyPropertyChanged> item) override;
+    
+    void render(const Rect& origin) override;
+    
+    void update_mouse_position(Int2 cursor) override;
+    void update_mouse_state(MouseButton button, MouseState state) override;
+    void update_mouse_scroll(Int2 scroll) override;
+    
+    IVisualElement* hit_test(Int2 cursor) const override;
+    
+    void set_render_context(const RenderContext& context) override;
+    
+    void set_horizontal_offset(int val);
+    int get_horizontal_offset() const { return _offset.x; }
+    
+    void set_vertical_offset(int val);
+    int get_vertical_offset() const { return _offset.y; }
+    
+    int get_extent_width() const { return _extent.x; }
+    int get_extent_height() const { return _extent.y; }
+    
+private:
+    IVisualElement* get_content() const 
+    {
+        return get_elements().empty() ? nullptr : get_elements().front();
+    }
+    
+    // Pixel size of the content when shown in the given viewport
+    Int2 get_content_size(const Int2& viewport) const;
+    
+    Int2 _offset = { 0, 0 };
+    Int2 _extent = { 0, 0 };
+    Int2 _cursor = { -1, -1 };
+    Rect _rect;
+    Rect _visible;
+    
+    const int DEFAULT_VIEWPORT = 200;
+    const int SCROLL_STEP = 40;
+};
+
+template<>
+struct TypeDefinition<ScrollViewer>
+{
+    static std::shared_ptr<ITypeDefinition> make() 
+    {
+        ExtendClass(ScrollViewer, ControlBase)
+             ->AddProperty(get_horizontal_offset, set_horizontal_offset)
+             ->AddProperty(get_vertical_offset, set_vertical_offset)
+             ->AddField(get_extent_width)
+             ->AddField(get_extent_height)
+             ;
+    }
+};
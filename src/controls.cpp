@@ -2,6 +2,8 @@
 
 #include <iomanip>
 #include <cmath>
+#include <limits>
+#include <cassert>
 
 #include "../easyloggingpp/easylogging++.h"
 
@@ -13,6 +15,7 @@ using namespace std;
 #include "../stb/stb_easy_font.h"
 
 #include "flat2d.h"
+#include "parallel.h"
 
 inline bool float_eq(float a, float b)
 {
@@ -146,13 +149,42 @@ Size2 Button::get_intrinsic_size() const
 
 Size2 TextBlock::get_intrinsic_size() const
 {
-    if (_text_mesh.get())
+    if (_wrap && _layout_version >= 0)
     {
-        return { _text_mesh->get_width() + 16, 
-                 _text_mesh->get_height() + 8 };
+        return { _wrapped_size.x, _wrapped_size.y };
     }
     
-    return {10,10};
+    auto loader = _measured_font;
+    auto metrics = _metrics;
+    if (!loader)
+    {
+        // not measured yet, the font may have come from a parent
+        // FontLoader::measure only reads the metrics, so this is fine
+        // during parallel layout, unlike remeasure
+        auto font = dynamic_cast<Font*>(get_font().get());
+        if (!font) return {10,10};
+        
+        loader = &font->get_loader();
+        metrics = loader->measure(_text);
+    }
+    
+    auto ratio = _text_size / (float)loader->get_native_size();
+    return { (int)(metrics.width * ratio) + 16, 
+             (int)(metrics.get_height() * ratio) + 8 };
+}
+
+void TextBlock::remeasure()
+{
+    // called on changes of the text and font, never while measuring
+    assert(!ParallelLayout::in_task());
+    
+    auto before = get_intrinsic_size();
+    
+    auto font = dynamic_cast<Font*>(get_font().get());
+    _measured_font = font ? &font->get_loader() : nullptr;
+    _metrics = font ? _measured_font->measure(_text) : TextMetrics();
+    
+    if (!(get_intrinsic_size() == before)) ControlBase::invalidate_layout();
 }
 
 TextBlock::TextBlock(std::string name,
@@ -164,24 +196,24 @@ TextBlock::TextBlock(std::string name,
         : ControlBase(name, position, size, alignment), 
           _color(color), _text(text)
 {
-    subscribe_on_change(this, [this](const char* prop_name){
-        std::string prop(prop_name);
-        if (prop == "font")
-        {
-            _refresh = true;
-        }
+    subscribe_on_change(this, PropertyName("font"), [this](const char* prop_name){
+        _refresh = true;
+        remeasure();
+    });
+    subscribe_on_change(this, PropertyName("parent"), [this](const char* prop_name){
+        remeasure();
     });
     
 }
     
 TextBlock::TextBlock()
 {
-    subscribe_on_change(this, [this](const char* prop_name){
-        std::string prop(prop_name);
-        if (prop == "font")
-        {
-            _refresh = true;
-        }
+    subscribe_on_change(this, PropertyName("font"), [this](const char* prop_name){
+        _refresh = true;
+        remeasure();
+    });
+    subscribe_on_change(this, PropertyName("parent"), [this](const char* prop_name){
+        remeasure();
     });
 }
 
@@ -196,7 +228,8 @@ void TextBlock::set_text(std::string text)
     {
         _text = text;
         _refresh = true;
-        fire_property_change("text");
+        remeasure();
+        fire_property_change(PropertyName("text"));
     }
     
 //    bool was_changed = (text != _text);
@@ -228,7 +261,7 @@ void TextBlock::set_text(std::string text)
 //    {
 //        _text = text;
 //    }
-//    if (was_changed) fire_property_change("text");
+//    if (was_changed) fire_property_change(PropertyName("text"));
 }
 
 void TextBlock::render(const Rect& origin)
@@ -251,20 +284,41 @@ void TextBlock::render(const Rect& origin)
         if (font)
         {
             auto& loader = font->get_loader();
-            //LOG(INFO) << "resetting " << _text;
-            _text_mesh.reset(new TextMesh(
-                loader, _text, _text_size,
-                _sdf_width, _sdf_edge, {0,0}, _color
-            ));
+            if (_wrap)
+            {
+                if (_layout.get_font() != &loader) _line_meshes.clear();
+                _layout.set_font(&loader);
+                _layout.set_text(_text);
+                _layout_version = -1;
+                _text_mesh.reset(nullptr);
+            }
+            else
+            {
+                //LOG(INFO) << "resetting " << _text;
+                _text_mesh.reset(new TextMesh(
+                    loader, _text, _text_size,
+                    _sdf_width, _sdf_edge, {0,0}, _color
+                ));
+            }
         }
         else
         {
             _text_mesh.reset(nullptr);
+            _layout.set_font(nullptr);
+            _line_meshes.clear();
+            _shown_meshes.clear();
+            _layout_version = -1;
         }
-        ControlBase::invalidate_layout();
+        remeasure();
         _refresh = false;
     }
     
+    if (_wrap)
+    {
+        render_wrapped(rect);
+        return;
+    }
+    
     //LOG(INFO) << "rendering " << _text;
     if (_text_mesh.get())
     {
@@ -293,10 +347,140 @@ void TextBlock::render(const Rect& origin)
     }
 }
 
+void TextBlock::render_wrapped(const Rect& rect)
+{
+    auto font = _layout.get_font();
+    if (!font) return;
+    
+    auto ratio = _text_size / font->get_native_size();
+    auto line_height = font->get_line_height() * ratio;
+    
+    // the layout only re-breaks when the width actually changed
+    auto width = (int)(std::max(0, rect.size.x - 16) / ratio);
+    auto& lines = _layout.break_lines(width);
+    
+    if (_layout_version != _layout.get_version())
+    {
+        decltype(_line_meshes) meshes;
+        _shown_meshes.clear();
+        for (auto& line : lines)
+        {
+            auto text = _layout.get_line_text(line);
+            auto& mesh = meshes[text];
+            if (!mesh)
+            {
+                auto it = _line_meshes.find(text);
+                if (it != _line_meshes.end()) mesh = std::move(it->second);
+                else mesh.reset(new TextMesh(*font, text, _text_size,
+                                             _sdf_width, _sdf_edge, {0,0}, _color));
+            }
+            _shown_meshes.push_back(mesh.get());
+        }
+        _line_meshes = std::move(meshes);
+        _layout_version = _layout.get_version();
+        
+        Int2 size { (int)(_layout.get_natural_width() * ratio) + 16,
+                    (int)(lines.size() * line_height) + 8 };
+        if (!(size == _wrapped_size))
+        {
+            _wrapped_size = size;
+            ControlBase::invalidate_layout();
+        }
+    }
+    
+    auto renderer = get_render_context().font_renderer;
+    auto viewport = get_render_context().viewport;
+    
+    auto total = (int)(lines.size() * line_height);
+    auto top = rect.position.y + std::max(4, (rect.size.y - total) / 2);
+    
+    for (auto i = 0; i < (int)lines.size(); i++)
+    {
+        auto y = top + (int)(i * line_height);
+        if (viewport && (y + line_height < viewport->position.y ||
+                         y > viewport->position.y + viewport->size.y)) continue;
+        
+        auto line_width = (int)(lines[i].width * ratio);
+        
+        Int2 position;
+        if (get_align() == Alignment::left){
+            position = {rect.position.x + 8, y};
+        } else if (get_align() == Alignment::center){
+            position = {rect.position.x + rect.size.x / 2 - line_width / 2, y};
+        } else {
+            position = {rect.position.x + rect.size.x - line_width - 8, y};
+        }
+        
+        auto mesh = _shown_meshes[i];
+        mesh->set_sdf_width(_sdf_width);
+        mesh->set_sdf_edge(_sdf_edge);
+        mesh->set_text_size(_text_size);
+        mesh->set_position(position);
+        renderer->render(*mesh);
+    }
+}
+
+namespace
+{
+    // ticks closer than this are thinned out
+    const int MIN_TICK_SPACING = 8;
+    const int TICK_LABEL_SIZE = 12;
+    // 2^62, exact in a double and far from overflowing a long long
+    const double MAX_STEP_COUNT = 4611686018427387904.0;
+    
+    // Number of decimal places needed to write x, up to 6
+    int decimal_places(double x)
+    {
+        auto scale = 1.0;
+        for (auto d = 0; d < 6; d++, scale *= 10)
+        {
+            auto scaled = x * scale;
+            if (std::abs(scaled - std::round(scaled)) < 1e-4) return d;
+        }
+        return 6;
+    }
+}
 
 Size2 Slider::get_intrinsic_size() const
 {
-    return { 120, 20 };
+    auto font = get_label_font();
+    return { 120, 20 + (font ? get_label_height(font) : 0) };
+}
+
+long long Slider::get_step_count() const
+{
+    if (_step <= 0 || _max <= _min) return 0;
+    // clamped in double, a float range can hold more steps than fit an integer
+    auto count = std::floor(((double)_max - _min) / _step + 1e-4);
+    return (long long)clamp(count, 0.0, MAX_STEP_COUNT);
+}
+
+float Slider::get_step_value(long long index) const
+{
+    auto scale = std::pow(10.0, std::max(decimal_places(_min), 
+                                         decimal_places(_step)));
+    return (float)(std::round(((double)_min + index * (double)_step) * scale) / scale);
+}
+
+float Slider::snap(float val) const
+{
+    if (_step <= 0) return clamp(val, _min, _max);
+    
+    auto index = std::round(((double)val - _min) / _step);
+    return get_step_value((long long)clamp(index, 0.0, (double)get_step_count()));
+}
+
+const FontLoader* Slider::get_label_font() const
+{
+    if (!_show_ticks || _step <= 0) return nullptr;
+    auto font = dynamic_cast<Font*>(get_font().get());
+    return font ? &font->get_loader() : nullptr;
+}
+
+int Slider::get_label_height(const FontLoader* font) const
+{
+    auto ratio = TICK_LABEL_SIZE / (float)font->get_native_size();
+    return (int)(font->measure("0123456789").get_height() * ratio) + 4;
 }
 
 void draw_diamond(Flat2dRenderer* renderer,
@@ -309,6 +493,59 @@ void draw_diamond(Flat2dRenderer* renderer,
     renderer->render(r);
 }
 
+void Slider::update_ticks(const Rect& rect, int track_height)
+{
+    auto font = get_label_font();
+    if (!_ticks_dirty && _ticks_size == rect.size && _ticks_font == font) return;
+    
+    _ticks.clear();
+    _ticks_dirty = false;
+    _ticks_size = rect.size;
+    _ticks_font = font;
+    
+    auto width = rect.size.x;
+    if (!_show_ticks || _step <= 0 || _max <= _min || width <= 0) return;
+    
+    // only every stride-th step gets a tick, so their count is
+    // bounded by the width no matter how fine the steps are
+    auto count = get_step_count();
+    auto spacing = width * (double)_step / (_max - _min + 0.01f);
+    auto stride = (long long)clamp(std::ceil(MIN_TICK_SPACING / spacing), 
+                                   1.0, count + 1.0);
+    
+    auto ratio = font ? TICK_LABEL_SIZE / (float)font->get_native_size() : 0;
+    auto line_color = _color.mix_with(_text_color, 0.5f);
+    auto labels_end = std::numeric_limits<int>::min();
+    
+    for (auto k = 0ll; k <= count / stride; k++)
+    {
+        auto value = get_step_value(k * stride);
+        auto t = (value - _min) / (_max - _min + 0.01f);
+        auto x = (int)lerp(0, width, t);
+        
+        Tick tick;
+        tick.x = x;
+        tick.line.reset(new Flat2dRect({ { x, 3 }, { 1, track_height - 6 } }, 
+                                       line_color));
+        
+        if (font)
+        {
+            // labels are dropped where they would overlap the previous one
+            auto text = stringify(value);
+            auto text_width = (int)(font->measure(text).width * ratio);
+            auto label_x = clamp(x - text_width / 2, 0, std::max(0, width - text_width));
+            if (label_x > labels_end + 4)
+            {
+                tick.label.reset(new TextMesh(*font, text, TICK_LABEL_SIZE,
+                                              0.2f, 0.4f, { label_x, track_height + 2 }, 
+                                              _text_color));
+                labels_end = label_x + text_width;
+            }
+        }
+        _ticks.push_back(std::move(tick));
+    }
+}
+
 void Slider::render(const Rect& origin) 
 {
     auto bg_color = _color;
@@ -322,96 +559,59 @@ void Slider::render(const Rect& origin)
     const auto pad = 1;
     auto rect = arrange(origin);
     _rect = rect;
+    
+    auto font = get_label_font();
+    _label_height = font ? get_label_height(font) : 0;
 
     auto x0 = rect.position.x;
     auto x1 = rect.position.x + rect.size.x;
     
-    auto text_y = rect.position.y + rect.size.y;// get_text_height();
-    
-    auto min_txt = stringify(_min);
-    auto max_txt = stringify(_max);
-    
-    //auto max_x = x1 - get_text_width(max_txt.c_str());
-    //auto min_x = x0 + get_text_width(min_txt.c_str());
+    auto text_y = rect.position.y + rect.size.y - _label_height;
     
-    auto value_txt = stringify(_value);
-    //auto value_width = get_text_width(value_txt.c_str());
     auto v = (clamp(_value, _min, _max) - _min) / (_max - _min + 0.01f);
     auto value_x = (int)lerp(x0, x1, v);
-    //auto value_x0 = (int)(value_x - value_width / 2.0f);
-    //if (float_eq(_value, _min)) value_x0 = value_x;
-    //if (float_eq(_value, _max)) value_x0 = value_x - value_width;
-    //auto value_x1 = value_x0 + value_width;
-    //interval<int> value { value_x0, value_x1 };
 
     Rect bg_rect { { x0, rect.position.y + pad }, { x1 - x0, text_y - 2*pad - 1 - rect.position.y } };
     
     Flat2dRect r(bg_rect, bg_color);
     auto renderer = get_render_context().flat2d_renderer;
     renderer->render(r);
-
-    //glBegin(GL_QUADS);
     
-    //glVertex2i(x0, rect.position.y + pad);
-    //glVertex2i(x0, text_y - pad - 1);
-    //glVertex2i(x1,
-    //           text_y - pad - 1);
-    //glVertex2i(x1,
-    //           rect.position.y + pad);
-
-    //glEnd();
-
-    
-    //if (min_x <= value_x0) draw_text(x0, text_y, min_txt);
-    //if (max_x >= value_x1) draw_text(max_x, text_y, max_txt);
-    //draw_text(value_x0, text_y, value_txt);
-    
-    /*if (!float_eq(_step, 0.0f))
+    update_ticks(rect, text_y - rect.position.y);
+    if (!_ticks.empty())
     {
-        auto last_x = min_x;
-        auto last_line_x = x0;
-        for (auto i = _min; i < _max; i += _step)
+        // the geometry is relative to the slider, so it is
+        // only moved into place by the renderers' translation
+        auto font_renderer = get_render_context().font_renderer;
+        auto viewport = get_render_context().viewport;
+        auto flat_translation = renderer->get_translation();
+        auto font_translation = font_renderer->get_translation();
+        renderer->set_translation(flat_translation + rect.position);
+        font_renderer->set_translation(font_translation + rect.position);
+        
+        for (auto& tick : _ticks)
         {
-            auto marker_txt = stringify(i);
-            auto marker_width = get_text_width(marker_txt);
-            auto t = (i - _min) / (_max - _min + 0.01f);
-            auto marker_center = lerp(x0, x1, t);
-            auto marker_x0 = (int)(marker_center - marker_width / 2.0f);
-            auto marker_x1 = marker_x0 + marker_width;
+            auto x = x0 + tick.x;
+            if (viewport && (x < viewport->position.x || 
+                             x > viewport->position.x + viewport->size.x)) continue;
             
-            interval<int> marker { marker_x0, marker_x1 };
-            marker = marker.grow(1);
-            interval<int> free { last_x, max_x };
-
-            if (free.contains(marker) && !marker.intersects(value))
-            {
-                draw_text(marker_x0, text_y, marker_txt);
-                last_x = marker_x1;
-                
-                glBegin(GL_LINES);
-                glVertex2i(marker_center, rect.position.y + pad + 2);
-                glVertex2i(marker_center, text_y - pad - 3);
-                glEnd();
-                last_line_x = marker_center;
-            }
+            renderer->render(*tick.line);
+            if (tick.label) font_renderer->render(*tick.label);
         }
-    }*/
+        
+        renderer->set_translation(flat_translation);
+        font_renderer->set_translation(font_translation);
+    }
     
     auto size = (text_y - rect.position.y) / 2 - pad;
     auto btn_y = rect.position.y + pad + size;
     auto btn_x = value_x;
     
-    
-    //glBegin(GL_QUADS);
-    
     draw_diamond(renderer, btn_x, btn_y, size, txt_color);
     
     if (_dragger_ready || _dragging) bg_color = -bg_color;
 
     draw_diamond(renderer, btn_x, btn_y, size - 3, bg_color);
-    //draw_diamond(btn_x, btn_y, size - 3);
-
-    //glEnd();
 }
 
 void Slider::update_mouse_position(Int2 cursor)
@@ -422,7 +622,7 @@ void Slider::update_mouse_position(Int2 cursor)
     auto x0 = rect.position.x;
     auto x1 = rect.position.x + rect.size.x;
     
-    auto text_y = rect.position.y + rect.size.y /*- get_text_height()*/;
+    auto text_y = rect.position.y + rect.size.y - _label_height;
     
     auto size = (text_y - rect.position.y) / 2 - pad;
     auto btn_y = rect.position.y + pad + size;
@@ -440,31 +640,12 @@ void Slider::update_mouse_position(Int2 cursor)
     if (_dragging)
     {
         auto x = clamp(cursor.x, x0, x1);
-        auto min_dist = x - x0;
-        auto min_val = _min;
-        if (_step)
-        {
-            for (auto i = _min; i <= _max; i += _step)
-            {
-                auto t = (i - _min) / (_max - _min + 0.01f);
-                auto marker = (int)lerp(x0, x1, t);
-                auto dist = std::abs(x - marker);
-                if (dist < min_dist)
-                {
-                    min_dist = dist;
-                    min_val = i;
-                }
-            }
-            set_value(min_val);
-        }
-        else
-        {
-            auto t = (x - x0) / (x1 - x0 + 0.01f);
-            set_value(lerp(_min, _max, t));
-        }
+        auto t = (x - x0) / (x1 - x0 + 0.01f);
+        auto val = lerp(_min, _max, t);
+        set_value(_step ? snap(val) : val);
     }
 }
-    
+
 void Slider::update_mouse_state(MouseButton button, MouseState state)
 {
     if (_dragger_ready && 
@@ -479,4 +660,259 @@ void Slider::update_mouse_state(MouseButton button, MouseState state)
     }
 }
 
+TextBox::~TextBox()
+{
+    KeyboardFocus::release(this);
+}
+
+Size2 TextBox::get_intrinsic_size() const
+{
+    auto font = dynamic_cast<Font*>(get_font().get());
+    if (!font) return { 120, 24 };
+    
+    auto& loader = font->get_loader();
+    auto ratio = _text_size / (float)loader.get_native_size();
+    return { 120, (int)(loader.get_line_height() * ratio) + 8 };
+}
+
+void TextBox::set_text(const std::string& text)
+{
+    if (text == get_text()) return;
+    
+    _text = text;
+    _uncommitted = false;
+    _buffer.assign(text);
+    _caret = _anchor = _buffer.size();
+    _remesh_from = 0;
+    fire_property_change(PropertyName("text"));
+}
+
+const std::string& TextBox::get_text() const
+{
+    if (_text_stale)
+    {
+        _text = _buffer.str();
+        _text_stale = false;
+    }
+    return _text;
+}
 
+void TextBox::commit()
+{
+    if (!_uncommitted) return;
+    
+    _uncommitted = false;
+    _text_stale = true;
+    fire_property_change(PropertyName("text"));
+}
+
+void TextBox::before_edit()
+{
+    // the committed text is about to leave the buffer, unless the edit
+    // is committed right away
+    if (_text_stale && _update_trigger != UpdateTrigger::keystroke) get_text();
+}
+
+void TextBox::edited(int from)
+{
+    _uncommitted = true;
+    _remesh_from = (_remesh_from < 0) ? from : std::min(_remesh_from, from);
+    if (_update_trigger == UpdateTrigger::keystroke) commit();
+}
+
+void TextBox::insert(const std::string& text)
+{
+    erase_selection();
+    before_edit();
+    
+    auto from = _caret;
+    _buffer.insert(_caret, text);
+    _caret = _anchor = _caret + (int)text.size();
+    edited(from);
+}
+
+void TextBox::erase(int from, int to)
+{
+    if (to <= from) return;
+    
+    before_edit();
+    _buffer.erase(from, to - from);
+    _caret = _anchor = from;
+    edited(from);
+}
+
+bool TextBox::erase_selection()
+{
+    if (_caret == _anchor) return false;
+    erase(std::min(_caret, _anchor), std::max(_caret, _anchor));
+    return true;
+}
+
+void TextBox::move_caret(int pos, bool extend)
+{
+    _caret = clamp(pos, 0, _buffer.size());
+    if (!extend) _anchor = _caret;
+}
+
+void TextBox::update_key(Key key, bool shift, bool control)
+{
+    auto from = std::min(_caret, _anchor);
+    auto to = std::max(_caret, _anchor);
+    
+    switch (key)
+    {
+    case Key::left:
+        move_caret((!shift && from != to) ? from : _caret - 1, shift);
+        break;
+    case Key::right:
+        move_caret((!shift && from != to) ? to : _caret + 1, shift);
+        break;
+    case Key::home:
+        move_caret(0, shift);
+        break;
+    case Key::end:
+        move_caret(_buffer.size(), shift);
+        break;
+    case Key::backspace:
+        if (!erase_selection() && _caret > 0) erase(_caret - 1, _caret);
+        break;
+    case Key::del:
+        if (!erase_selection() && _caret < _buffer.size()) erase(_caret, _caret + 1);
+        break;
+    case Key::enter:
+        commit();
+        break;
+    case Key::escape:
+        // drops whatever was not committed yet
+        _buffer.assign(get_text());
+        _uncommitted = false;
+        _caret = _anchor = _buffer.size();
+        _remesh_from = 0;
+        break;
+    case Key::a:
+        if (control)
+        {
+            _anchor = 0;
+            _caret = _buffer.size();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void TextBox::update_char(unsigned int codepoint)
+{
+    // fonts are indexed by char, so anything beyond it can't be drawn
+    if (codepoint < 32 || codepoint == 127 || codepoint > 255) return;
+    insert(std::string(1, (char)codepoint));
+}
+
+void TextBox::set_keyboard_focus(bool on)
+{
+    _keyboard_focus = on;
+    if (!on)
+    {
+        commit();
+        _anchor = _caret;
+        _selecting = false;
+    }
+}
+
+int TextBox::get_text_x() const
+{
+    return _rect.position.x + 4 - _scroll;
+}
+
+void TextBox::update_mouse_position(Int2 cursor)
+{
+    _cursor = cursor;
+    if (_selecting && _mesh)
+    {
+        move_caret(_mesh->hit_test(cursor.x - get_text_x()), true);
+    }
+}
+
+void TextBox::update_mouse_state(MouseButton button, MouseState state)
+{
+    ControlBase::update_mouse_state(button, state);
+    if (button != MouseButton::left) return;
+    
+    if (state == MouseState::down && is_enabled())
+    {
+        KeyboardFocus::set(this);
+        if (_mesh) move_caret(_mesh->hit_test(_cursor.x - get_text_x()), false);
+        _selecting = true;
+    }
+    else if (state == MouseState::up)
+    {
+        _selecting = false;
+    }
+}
+
+void TextBox::render(const Rect& origin)
+{
+    auto c = _color;
+    if (!is_enabled()) c = c.mix_with(c.to_grayscale(), 0.7);
+    else if (_keyboard_focus) c = c.brighten(1.3f);
+    else if (is_focused()) c = c.brighten(1.1f);
+    
+    auto rect = arrange(origin);
+    _rect = rect;
+    
+    auto renderer = get_render_context().flat2d_renderer;
+    Flat2dRect r(rect, c);
+    renderer->render(r);
+    
+    auto font = dynamic_cast<Font*>(get_font().get());
+    if (!font) return;
+    auto& loader = font->get_loader();
+    
+    if (!_mesh || _mesh_font != &loader)
+    {
+        _mesh.reset(new TextMesh(loader, _buffer.spans(), _text_size,
+                                 0.2f, 0.4f, {0,0}, _text_color));
+        _mesh_font = &loader;
+        _remesh_from = -1;
+    }
+    else if (_remesh_from >= 0)
+    {
+        _mesh->update(_buffer.spans(), _remesh_from);
+        _remesh_from = -1;
+    }
+    _mesh->set_text_size(_text_size);
+    
+    // scrolls just enough to keep the caret in view
+    auto inner = rect.size.x - 8;
+    auto caret_x = _mesh->get_pen_x(_caret);
+    if (caret_x - _scroll > inner) _scroll = caret_x - inner;
+    if (caret_x < _scroll) _scroll = caret_x;
+    
+    auto ratio = _text_size / (float)loader.get_native_size();
+    auto line_height = (int)(loader.get_line_height() * ratio);
+    auto text_x = get_text_x();
+    auto text_y = rect.position.y + (rect.size.y - line_height) / 2;
+    
+    renderer->push_clip({ { rect.position.x + 2, rect.position.y }, 
+                          { rect.size.x - 4, rect.size.y } });
+    
+    if (_caret != _anchor)
+    {
+        auto x0 = _mesh->get_pen_x(std::min(_caret, _anchor));
+        auto x1 = _mesh->get_pen_x(std::max(_caret, _anchor));
+        Flat2dRect selection({ { text_x + x0, text_y }, { x1 - x0, line_height } },
+                             c.mix_with(_text_color, 0.3f));
+        renderer->render(selection);
+    }
+    
+    _mesh->set_position({ text_x, text_y });
+    get_render_context().font_renderer->render(*_mesh);
+    
+    if (_keyboard_focus)
+    {
+        Flat2dRect caret({ { text_x + caret_x, text_y }, { 1, line_height } }, _text_color);
+        renderer->render(caret);
+    }
+    
+    renderer->pop_clip();
+}
@@ -1,6 +1,9 @@
 #pragma once
 #include "ui.h"
 #include "font.h"
+#include "text.h"
+#include "flat2d.h"
+#include "input.h"
 
 class TextBlock : public ControlBase
 {
@@ -27,13 +30,13 @@ public:
     
     void set_color(Color3 color) { 
         _color = color; 
-        fire_property_change("color");
+        fire_property_change(PropertyName("color"));
     }
     const Color3& get_color() const { return _color; }
 
     void set_text_size(float size) {
         _text_size = size;
-        fire_property_change("text_size");
+        fire_property_change(PropertyName("text_size"));
         ControlBase::invalidate_layout();
     }
     float get_text_size() const { return _text_size; }
@@ -41,22 +44,47 @@ public:
 
     void set_sdf_width(float width) {
         _sdf_width = width;
-        fire_property_change("sdf_width");
+        fire_property_change(PropertyName("sdf_width"));
     }
     float get_sdf_width() const { return _sdf_width; }
 
     void set_sdf_edge(float edge) {
         _sdf_edge = edge;
-        fire_property_change("sdf_edge");
+        fire_property_change(PropertyName("sdf_edge"));
     }
     float get_sdf_edge() const { return _sdf_edge; }
 
+    void set_wrap(bool val) {
+        _wrap = val;
+        _refresh = true;
+        fire_property_change(PropertyName("wrap"));
+        ControlBase::invalidate_layout();
+    }
+    bool get_wrap() const { return _wrap; }
 
 private:
+    void render_wrapped(const Rect& rect);
+    
+    // Refreshes the cached metrics, invalidating the layout
+    // only if the size of the text block actually changed
+    void remeasure();
+
     Color3 _color = { 1.0f, 1.0f, 1.0f };
     std::string _text = "";
     std::unique_ptr<TextMesh> _text_mesh;
     bool _refresh = false;
+    bool _wrap = false;
+    
+    // measured from the font metrics, no mesh is needed to size the block
+    const FontLoader* _measured_font = nullptr;
+    TextMetrics _metrics;
+    
+    // wrapped text, meshes are kept per line and reused by content
+    TextLayout _layout;
+    int _layout_version = -1;
+    std::unordered_map<std::string, std::unique_ptr<TextMesh>> _line_meshes;
+    std::vector<TextMesh*> _shown_meshes;
+    Int2 _wrapped_size = { 0, 0 };
     float _text_size = 16;
     float _sdf_width = 0.2f;
     float _sdf_edge = 0.4f;
@@ -96,27 +124,27 @@ public:
     
     void set_color(Color3 color) { 
         _color = color; 
-        fire_property_change("color");
+        fire_property_change(PropertyName("color"));
     }
     const Color3& get_color() const { return _color; }
     
     void set_text_color(Color3 color) { 
         _text_block.set_color(color);
-        fire_property_change("text_color");
+        fire_property_change(PropertyName("text_color"));
     }
     const Color3& get_text_color() const { return _text_block.get_color(); }
     
     void set_text(std::string text) 
     { 
         _text_block.set_text(text);
-        fire_property_change("text");
+        fire_property_change(PropertyName("text"));
     }
     const std::string& get_text() const { return _text_block.get_text(); }
     
     void set_text_align(Alignment val) 
     { 
         _text_block.set_align(val);
-        fire_property_change("text_align");
+        fire_property_change(PropertyName("text_align"));
     }
     Alignment get_text_align() const { return _text_block.get_align(); }
     
@@ -128,7 +156,7 @@ public:
 
     void set_corner_radius(float val) {
         _corner_radius = val;
-        fire_property_change("corner_radius");
+        fire_property_change(PropertyName("corner_radius"));
     }
     float get_corner_radius() const { return _corner_radius; }
 
@@ -177,53 +205,80 @@ public:
     
     void set_value(float val) { 
         _value = val; 
-        fire_property_change("value");
+        fire_property_change(PropertyName("value"));
     }
     float get_value() const { return _value; }
     
     void set_min(float val) { 
         _min = val; 
-        fire_property_change("min");
+        _ticks_dirty = true;
+        fire_property_change(PropertyName("min"));
     }
     float get_min() const { return _min; }
     
     void set_max(float val) { 
         _max = val; 
-        fire_property_change("max");
+        _ticks_dirty = true;
+        fire_property_change(PropertyName("max"));
     }
     float get_max() const { return _max; }
     
     void set_step(float val) { 
         _step = val; 
-        fire_property_change("step");
+        _ticks_dirty = true;
+        fire_property_change(PropertyName("step"));
     }
     float get_step() const { return _step; }
     
     void set_show_ticks(bool val) { 
         _show_ticks = val; 
-        fire_property_change("show_ticks");
+        _ticks_dirty = true;
+        fire_property_change(PropertyName("show_ticks"));
+        ControlBase::invalidate_layout();
     }
     bool get_show_ticks() const { return _show_ticks; }
     
     void set_orientation(Orientation val) { 
         _orientation = val; 
-        fire_property_change("orientation");
+        fire_property_change(PropertyName("orientation"));
     }
     Orientation get_orientation() const { return _orientation; }
     
     void set_color(const Color3& val) { 
         _color = val; 
-        fire_property_change("color");
+        _ticks_dirty = true;
+        fire_property_change(PropertyName("color"));
     }
     const Color3& get_color() const { return _color; }
     
     void set_text_color(const Color3& val) { 
         _text_color = val; 
-        fire_property_change("text_color");
+        _ticks_dirty = true;
+        fire_property_change(PropertyName("text_color"));
     }
     const Color3& get_text_color() const { return _text_color; }
+    
+    // Nearest value on the step grid, computed directly rather than by
+    // walking the steps, and rounded to the decimals of min and step so
+    // that 0.1 steps land on 0.3 and not on 0.30000001
+    float snap(float val) const;
 
 private:
+    struct Tick
+    {
+        int x;
+        std::unique_ptr<Flat2dRect> line;
+        std::unique_ptr<TextMesh> label;
+    };
+    
+    long long get_step_count() const;
+    float get_step_value(long long index) const;
+    
+    const FontLoader* get_label_font() const;
+    int get_label_height(const FontLoader* font) const;
+    
+    void update_ticks(const Rect& rect, int track_height);
+    
     float _min = 0.0f;
     float _max = 100.0f;
     float _step = 20.0f;
@@ -236,6 +291,139 @@ private:
     bool _dragger_ready = false;
     bool _dragging = false;
     Rect _rect;
+    int _label_height = 0;
+    
+    // tick geometry relative to the slider, rebuilt when the arranged
+    // size, the font or any of the properties it depends on changes
+    std::vector<Tick> _ticks;
+    bool _ticks_dirty = true;
+    Int2 _ticks_size = { -1, -1 };
+    const FontLoader* _ticks_font = nullptr;
+};
+
+// Single line text input
+// The text is edited in a gap buffer and the mesh is only rebuilt from the
+// first changed character on. Clicking the box takes the keyboard focus,
+// depending on the update trigger the text property follows every edit or
+// only changes on enter and when the focus is lost
+class TextBox : public ControlBase, public IKeyboardTarget
+{
+public:
+    TextBox(std::string name,
+            std::string text,
+            const Size2& position,
+            const Size2& size)
+        : ControlBase(name, position, size, Alignment::left)
+    {
+        set_text(text);
+    }
+    
+    TextBox() {}
+    ~TextBox();
+    
+    const char* get_type() const override { return "TextBox"; }
+    
+    Size2 get_intrinsic_size() const override;
+    
+    void render(const Rect& origin) override;
+    
+    void update_mouse_position(Int2 cursor) override;
+    void update_mouse_state(MouseButton button, MouseState state) override;
+    
+    void set_focused(bool on) override 
+    {
+        if (!on) _selecting = false;
+        ControlBase::set_focused(on);
+    }
+    
+    void update_key(Key key, bool shift, bool control) override;
+    void update_char(unsigned int codepoint) override;
+    void set_keyboard_focus(bool on) override;
+    
+    // Replaces the edited text as well, unless it is the same
+    void set_text(const std::string& text);
+    // The committed text, copied out of the edit buffer when first read
+    const std::string& get_text() const;
+    
+    void set_update_trigger(UpdateTrigger val) {
+        _update_trigger = val;
+        fire_property_change(PropertyName("update_trigger"));
+    }
+    UpdateTrigger get_update_trigger() const { return _update_trigger; }
+    
+    void set_color(const Color3& val) { 
+        _color = val; 
+        fire_property_change(PropertyName("color"));
+    }
+    const Color3& get_color() const { return _color; }
+    
+    void set_text_color(const Color3& val) { 
+        _text_color = val; 
+        _remesh_from = 0;
+        _mesh.reset();
+        fire_property_change(PropertyName("text_color"));
+    }
+    const Color3& get_text_color() const { return _text_color; }
+    
+    void set_text_size(float val) {
+        _text_size = val;
+        fire_property_change(PropertyName("text_size"));
+        ControlBase::invalidate_layout();
+    }
+    float get_text_size() const { return _text_size; }
+    
+    int get_caret() const { return _caret; }
+    
+private:
+    void insert(const std::string& text);
+    void erase(int from, int to);
+    bool erase_selection();
+    void move_caret(int pos, bool extend);
+    
+    // Writes the edited text back into the text property
+    void commit();
+    void before_edit();
+    void edited(int from);
+    
+    int get_text_x() const;
+    
+    GapBuffer _buffer;
+    mutable std::string _text;
+    // committed, but _text still has to be copied out of the buffer
+    mutable bool _text_stale = false;
+    bool _uncommitted = false;
+    int _caret = 0;
+    int _anchor = 0;
+    
+    UpdateTrigger _update_trigger = UpdateTrigger::keystroke;
+    Color3 _color = { 0.15f, 0.15f, 0.15f };
+    Color3 _text_color = { 1.0f, 1.0f, 1.0f };
+    float _text_size = 16;
+    
+    std::unique_ptr<TextMesh> _mesh;
+    const FontLoader* _mesh_font = nullptr;
+    int _remesh_from = -1;
+    
+    bool _keyboard_focus = false;
+    bool _selecting = false;
+    int _scroll = 0;
+    Rect _rect;
+    Int2 _cursor = { 0, 0 };
+};
+
+template<>
+struct TypeDefinition<TextBox>
+{
+    static std::shared_ptr<ITypeDefinition> make() 
+    {
+        ExtendClass(TextBox, ControlBase)
+             ->AddProperty(get_text, set_text)
+             ->AddProperty(get_update_trigger, set_update_trigger)
+             ->AddProperty(get_color, set_color)
+             ->AddProperty(get_text_color, set_text_color)
+             ->AddProperty(get_text_size, set_text_size)
+             ;
+    }
 };
 
 template<>
@@ -281,6 +469,7 @@ struct TypeDefinition<TextBlock>
              ->AddProperty(get_text_size, set_text_size)
              ->AddProperty(get_sdf_width, set_sdf_width)
              ->AddProperty(get_sdf_edge, set_sdf_edge)
+             ->AddProperty(get_wrap, set_wrap)
              ;
     }
 };
@@ -35,6 +35,9 @@ void Flat2dRenderer::render(const Flat2dRect& rect) const
     myLoc = glGetUniformLocation(_shader->get_id(), "screen_size");
     glUniform2f(myLoc, _size.x, _size.y);
     
+    myLoc = glGetUniformLocation(_shader->get_id(), "translation");
+    glUniform2f(myLoc, _translation.x, _translation.y);
+    
 
     myLoc = glGetUniformLocation(_shader->get_id(), "rect_size");
     glUniform2f(myLoc, rect._rect.size.x, rect._rect.size.y);
@@ -56,6 +59,42 @@ void Flat2dRenderer::render(const Flat2dRect& rect) const
     glDisable(GL_BLEND);
 }
 
+void Flat2dRenderer::push_clip(const Rect& rect)
+{
+    Rect clip { rect.position + _translation, rect.size };
+    if (!_clips.empty()) clip = intersection(_clips.back(), clip);
+    _clips.push_back(clip);
+    apply_clip();
+}
+
+void Flat2dRenderer::pop_clip()
+{
+    _clips.pop_back();
+    apply_clip();
+}
+
+void Flat2dRenderer::apply_clip() const
+{
+    if (_clips.empty())
+    {
+        glDisable(GL_SCISSOR_TEST);
+        return;
+    }
+    
+    // scissor works in framebuffer pixels, with Y going up
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    auto sx = _size.x ? viewport[2] / (float)_size.x : 1.0f;
+    auto sy = _size.y ? viewport[3] / (float)_size.y : 1.0f;
+    
+    auto& clip = _clips.back();
+    glEnable(GL_SCISSOR_TEST);
+    glScissor((int)(clip.position.x * sx),
+              (int)(viewport[3] - (clip.position.y + clip.size.y) * sy),
+              (int)(clip.size.x * sx),
+              (int)(clip.size.y * sy));
+}
+
 Flat2dRect::Flat2dRect(const Rect& rect,
                        const Color3& color)
     : _color(color), _rect(rect)
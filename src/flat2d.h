@@ -36,7 +36,20 @@ public:
     
     void render(const Flat2dRect& rect) const;
     
+    // Offset applied to everything rendered, used for scrolling
+    void set_translation(const Int2& translation) { _translation = translation; }
+    const Int2& get_translation() const { return _translation; }
+    
+    // Restricts all rendering to the rect, given in translated coordinates
+    // Nested clips are intersected with the enclosing ones
+    void push_clip(const Rect& rect);
+    void pop_clip();
+    
 private:
+    void apply_clip() const;
+
     std::unique_ptr<ShaderProgram> _shader;
     Int2 _size;
+    Int2 _translation = { 0, 0 };
+    std::vector<Rect> _clips;
 };
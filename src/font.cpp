@@ -8,11 +8,14 @@
 #include "font.h"
 
 #include <chrono>
+#include <cassert>
 
 #include "types.h"
 
 #include "parser.h"
 
+#include "parallel.h"
+
 #include "../easyloggingpp/easylogging++.h"
 
 #define GLFW_INCLUDE_GLU
@@ -61,12 +64,7 @@ Margin get_margin_param(const std::string& param, MinimalParser& line, int line_
 
 int FontLoader::get_kerning(char a, char b) const
 {
-    char buff[3];
-    buff[0] = a;
-    buff[1] = b;
-    buff[2] = '\0';
-    std::string s(buff);
-    auto it = _kerning.find(s);
+    auto it = _kerning.find(kerning_key(a, b));
     if (it != _kerning.end())
     {
         return it->second;
@@ -77,72 +75,46 @@ int FontLoader::get_kerning(char a, char b) const
     }
 }
 
-TextMesh::TextMesh(const FontLoader& font, const std::string& text, 
+TextMetrics FontLoader::measure(const std::string& text) const
+{
+    TextMetrics m;
+    auto min_y = 0;
+    auto max_y = 0;
+    auto first = true;
+    
+    for (auto i = 0; i < (int)text.size(); i++)
+    {
+        if (auto fc = lookup(text[i]))
+        {
+            auto y0 = -fc->yoffset;
+            auto y1 = y0 - fc->height;
+            min_y = first ? y1 : std::min(min_y, y1);
+            max_y = first ? y0 : std::max(max_y, y0);
+            first = false;
+        }
+        
+        m.width += get_advance(text[i]);
+        if (i + 1 < (int)text.size())
+        {
+            m.width += get_kerning(text[i], text[i+1]);
+        }
+    }
+    
+    m.min_y = min_y;
+    m.max_y = max_y;
+    return m;
+}
+
+TextMesh::TextMesh(const FontLoader& font, const TextSpans& text, 
                    int size, float sdf_width, float sdf_edge,
                    const Int2& position, const Color3& color)
     : _color(color), _font(font), _position(position)
 {   
-    auto x = 0;
-    auto y = 0;
-    
     _size_ratio = size / (float)font.get_native_size();
     _sdf_width = sdf_width;
     _sdf_edge = sdf_edge;
     
-    auto tex_scale = 1.0f / font.get_texture_size();
-    
-    _vertex_positions.reserve(text.size() * 8);
-    _texture_coords.reserve(text.size() * 8);
-    
-    auto min_y = 1000;
-    auto max_y = -1000;
-    
-    for (auto i = 0; i < text.size(); i++)
-    {
-        auto c = text[i];
-        auto& fc = *font.lookup(c);
-        auto x0 = x + fc.xoffset;
-        auto y0 = y - fc.yoffset;
-        auto x1 = x0 + fc.width;
-        auto y1 = y0 - fc.height;
-        
-        min_y = std::min(min_y, y0);
-        min_y = std::min(min_y, y1);
-        max_y = std::max(max_y, y0);
-        max_y = std::max(max_y, y1);
-        
-        _vertex_positions.push_back(x0);
-        _vertex_positions.push_back(y0);
-        _vertex_positions.push_back(x1);
-        _vertex_positions.push_back(y0);
-        _vertex_positions.push_back(x1);
-        _vertex_positions.push_back(y1);
-        _vertex_positions.push_back(x0);
-        _vertex_positions.push_back(y1);
-        
-        _texture_coords.push_back(tex_scale * fc.x);
-        _texture_coords.push_back(tex_scale * fc.y);
-        
-        _texture_coords.push_back(tex_scale * (fc.x + fc.width));
-        _texture_coords.push_back(tex_scale * fc.y);
-        
-        _texture_coords.push_back(tex_scale * (fc.x + fc.width));
-        _texture_coords.push_back(tex_scale * (fc.y + fc.height));
-        
-        _texture_coords.push_back(tex_scale * fc.x);
-        _texture_coords.push_back(tex_scale * (fc.y + fc.height));
-        
-
-        x += fc.xadvance - font.get_advance_adjustment();
-        
-        if (i+1 < text.size())
-        {
-            x += font.get_kerning(text[i], text[i+1]);
-        }
-    }
-    
-    _width = x;
-    _height = (max_y - min_y);
+    layout_from(text, 0);
     
     GLuint vao, vbo, vbo2;
     glGenVertexArrays(1, &vao);
@@ -150,14 +122,14 @@ TextMesh::TextMesh(const FontLoader& font, const std::string& text,
     glGenBuffers(1, &vbo);
     glEnableVertexAttribArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, get_size(), get_vertex_positions(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, get_size(), get_vertex_positions(), GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
     
 	glGenBuffers(1, &vbo2);
     glEnableVertexAttribArray(1);
     glBindBuffer(GL_ARRAY_BUFFER, vbo2);
 	
-	glBufferData(GL_ARRAY_BUFFER, get_size(), get_texture_coords(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, get_size(), get_texture_coords(), GL_DYNAMIC_DRAW);
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -167,6 +139,126 @@ TextMesh::TextMesh(const FontLoader& font, const std::string& text,
     _vao = vao;
     _vertex_vbo = vbo;
     _uv_vbo = vbo2;
+    _capacity = get_size();
+}
+
+void TextMesh::layout_from(const TextSpans& text, int from)
+{
+    // kerning with the edited character moves the one before it too
+    from = std::max(0, std::min(from - 1, (int)_pens.size() - 1));
+    from = std::min(from, text.size());
+    
+    _pens.resize(from + 1);
+    if (from == 0) _pens[0] = { 0, 0, 0, 0 };
+    auto pen = _pens[from];
+    
+    _vertex_positions.resize(pen.quads * 8);
+    _texture_coords.resize(pen.quads * 8);
+    _vertex_positions.reserve(text.size() * 8);
+    _texture_coords.reserve(text.size() * 8);
+    
+    auto tex_scale = 1.0f / _font.get_texture_size();
+    auto y = 0;
+    
+    for (auto i = from; i < text.size(); i++)
+    {
+        auto c = text[i];
+        auto fc = _font.lookup(c);
+        if (fc)
+        {
+            auto x0 = pen.x + fc->xoffset;
+            auto y0 = y - fc->yoffset;
+            auto x1 = x0 + fc->width;
+            auto y1 = y0 - fc->height;
+            
+            pen.min_y = pen.quads ? std::min(pen.min_y, y1) : y1;
+            pen.max_y = pen.quads ? std::max(pen.max_y, y0) : y0;
+            pen.quads++;
+            
+            _vertex_positions.push_back(x0);
+            _vertex_positions.push_back(y0);
+            _vertex_positions.push_back(x1);
+            _vertex_positions.push_back(y0);
+            _vertex_positions.push_back(x1);
+            _vertex_positions.push_back(y1);
+            _vertex_positions.push_back(x0);
+            _vertex_positions.push_back(y1);
+            
+            _texture_coords.push_back(tex_scale * fc->x);
+            _texture_coords.push_back(tex_scale * fc->y);
+            
+            _texture_coords.push_back(tex_scale * (fc->x + fc->width));
+            _texture_coords.push_back(tex_scale * fc->y);
+            
+            _texture_coords.push_back(tex_scale * (fc->x + fc->width));
+            _texture_coords.push_back(tex_scale * (fc->y + fc->height));
+            
+            _texture_coords.push_back(tex_scale * fc->x);
+            _texture_coords.push_back(tex_scale * (fc->y + fc->height));
+        }
+
+        pen.x += _font.get_advance(c);
+        
+        if (i+1 < text.size())
+        {
+            pen.x += _font.get_kerning(text[i], text[i+1]);
+        }
+        _pens.push_back(pen);
+    }
+    
+    // the same numbers FontLoader::measure gives, without a GL context
+    _width = pen.x;
+    _height = pen.max_y - pen.min_y;
+}
+
+void TextMesh::update(const TextSpans& text, int from)
+{
+    auto first_quad = _pens[std::max(0, std::min(from - 1, (int)_pens.size() - 1))].quads;
+    layout_from(text, from);
+    first_quad = std::min(first_quad, get_vertex_count() / 4);
+    
+    // only the quads from the edit point on are sent again,
+    // unless the buffers have to grow
+    auto offset = first_quad * 8 * (int)sizeof(float);
+    auto size = get_size();
+    
+    auto grow = size > _capacity;
+    if (grow)
+    {
+        _capacity = std::max(size, _capacity * 2);
+        offset = 0;
+    }
+    
+    glBindBuffer(GL_ARRAY_BUFFER, _vertex_vbo);
+    if (grow) glBufferData(GL_ARRAY_BUFFER, _capacity, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size - offset, 
+                    _vertex_positions.data() + offset / sizeof(float));
+    
+    glBindBuffer(GL_ARRAY_BUFFER, _uv_vbo);
+    if (grow) glBufferData(GL_ARRAY_BUFFER, _capacity, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size - offset, 
+                    _texture_coords.data() + offset / sizeof(float));
+    
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+int TextMesh::get_pen_x(int index) const
+{
+    index = std::max(0, std::min(index, (int)_pens.size() - 1));
+    return (int)(_pens[index].x * _size_ratio);
+}
+
+int TextMesh::hit_test(int x) const
+{
+    // pen positions only grow, so the nearest one is found by bisection
+    auto native = x / _size_ratio;
+    auto it = std::lower_bound(_pens.begin(), _pens.end(), native,
+        [](const Pen& p, float x) { return p.x < x; });
+    if (it == _pens.end()) return (int)_pens.size() - 1;
+    if (it == _pens.begin()) return 0;
+    
+    auto index = (int)(it - _pens.begin());
+    return (native - (it - 1)->x < it->x - native) ? index - 1 : index;
 }
 
 TextMesh::~TextMesh()
@@ -222,14 +314,13 @@ FontLoader::FontLoader(const std::string& filename)
             auto amount = get_param("amount", line, line_number);
             line.req_eof();
             
-            std::string combined = str() << (char)first << (char)second;
-            _kerning[combined] = amount;
+            _kerning[kerning_key((char)first, (char)second)] = amount;
         }
         else if (id == "common")
         {
             //common lineHeight=99 base=56 scaleW=1024 scaleH=1024 pages=1 packed=0
             
-            get_param("lineHeight", line, line_number);
+            _line_height = get_param("lineHeight", line, line_number);
             get_param("base", line, line_number);
             _texture_size = get_param("scaleW", line, line_number);
             line.rest();
@@ -273,30 +364,18 @@ FontLoader::FontLoader(const std::string& filename)
     //stb_image
     int x, y, comp;
     FILE *fh = fopen(cstr, "rb");
+    if (!fh)
+        throw std::runtime_error(str() << "Font texture " << name << " not found!");
     unsigned char *res;
-    res = stbi_load_from_file(fh,&x,&y,&comp,0);
+    res = stbi_load_from_file(fh,&x,&y,&comp,4);
     fclose(fh);
     
-    // Create one OpenGL texture
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    _texture_id = textureID;
-
-    // "Bind" the newly created texture : all future texture functions will modify this texture
-    glBindTexture(GL_TEXTURE_2D, textureID);
-
-    // Give the image to OpenGL
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, x, y, 0, GL_RGBA, GL_UNSIGNED_BYTE, res);
-    
+    // kept on the CPU until the font is first drawn, so that fonts
+    // can be loaded and measured without a GL context
+    _pixels.assign(res, res + x * y * 4);
+    _pixels_width = x;
+    _pixels_height = y;
     stbi_image_free(res);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    
-    glBindTexture(GL_TEXTURE_2D, 0);
     
     auto ended = chrono::high_resolution_clock::now();
     auto duration = chrono::duration_cast<chrono::milliseconds>(ended - started).count();
@@ -306,7 +385,7 @@ FontLoader::FontLoader(const std::string& filename)
 
 FontLoader::~FontLoader()
 {
-    glDeleteTextures(1, &_texture_id);
+    if (_texture_id) glDeleteTextures(1, &_texture_id);
 }
 
 void FontRenderer::set_window_size(const Int2& size) const
@@ -327,6 +406,32 @@ FontRenderer::FontRenderer()
 
 void FontLoader::begin() const
 {
+    if (!_texture_id)
+    {
+        // only render draws text, and it never runs in a layout task
+        assert(!ParallelLayout::in_task());
+        
+        // Create one OpenGL texture
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        _texture_id = textureID;
+
+        // "Bind" the newly created texture : all future texture functions will modify this texture
+        glBindTexture(GL_TEXTURE_2D, textureID);
+
+        // Give the image to OpenGL
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _pixels_width, _pixels_height, 
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, _pixels.data());
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        
+        std::vector<unsigned char>().swap(_pixels);
+    }
+    
     glBindTexture(GL_TEXTURE_2D, _texture_id);
     glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -351,6 +456,9 @@ void FontRenderer::render(const TextMesh& mesh) const
     myLoc = glGetUniformLocation(_shader->get_id(), "text_position");
     glUniform2f(myLoc, position.x, position.y);
     
+    myLoc = glGetUniformLocation(_shader->get_id(), "translation");
+    glUniform2f(myLoc, _translation.x, _translation.y);
+    
     auto size_ratio = mesh.get_size_ratio();
     myLoc = glGetUniformLocation(_shader->get_id(), "size_ratio");
     glUniform1f(myLoc, size_ratio);
@@ -3,6 +3,7 @@
 #include "shader.h"
 #include "types.h"
 #include "bind.h"
+#include "text.h"
 
 #include <string>
 #include <unordered_map>
@@ -26,7 +27,7 @@ public:
     TextMesh(const TextMesh&) = delete;
     
     TextMesh(const FontLoader& font, 
-             const std::string& text,
+             const TextSpans& text,
              int size, float sdf_width, float sdf_edge,
              const Int2& position,
              const Color3& c);
@@ -49,10 +50,35 @@ public:
     void set_text_size(float size);
     void set_sdf_width(float width) { _sdf_width = width; }
     void set_sdf_edge(float edge) { _sdf_edge = edge; }
+    
+    // Lays the glyphs out again from character "from" on, for text that is
+    // unchanged before it. Only the quads after the edit point are rebuilt
+    // and uploaded
+    void update(const TextSpans& text, int from);
+    
+    // Pen position before the character, relative to the mesh, in pixels
+    int get_pen_x(int index) const;
+    
+    // Index of the character boundary nearest to the x offset in pixels
+    int hit_test(int x) const;
 
     ~TextMesh();
 
 private:
+    // layout state before a character
+    struct Pen
+    {
+        int x;
+        int quads;
+        int min_y;
+        int max_y;
+    };
+    
+    void layout_from(const TextSpans& text, int from);
+    
+    std::vector<Pen> _pens;
+    int _capacity = 0;
+
     std::vector<float> _vertex_positions;
     std::vector<float> _texture_coords;
     int _width;
@@ -83,6 +109,17 @@ struct FontCharacter
     int xadvance;
 };
 
+// Size of a run of text in native font units, y pointing up from the
+// top of the line, the same space TextMesh vertices are generated in
+struct TextMetrics
+{
+    int width = 0;
+    int min_y = 0;
+    int max_y = 0;
+    
+    int get_height() const { return max_y - min_y; }
+};
+
 class FontRenderer
 {
 public:
@@ -92,8 +129,13 @@ public:
     
     void set_window_size(const Int2& size) const;
     
+    // Offset applied to every mesh position, used for scrolling
+    void set_translation(const Int2& translation) { _translation = translation; }
+    const Int2& get_translation() const { return _translation; }
+    
 private:
     std::unique_ptr<ShaderProgram> _shader;
+    Int2 _translation = { 0, 0 };
 };
 
 class FontLoader
@@ -108,26 +150,49 @@ public:
     }
 	
 	int get_kerning(char a, char b) const;
+    
+    // Measures the text from the font metrics alone
+    // Needs no GL context and is safe to call from any thread, the
+    // metrics never change after loading. Only the texture is lazy
+    TextMetrics measure(const std::string& text) const;
 	
 	int get_texture_size() const { return _texture_size; }
     
     int get_native_size() const { return _size; }
 	
 	int get_advance_adjustment() const { return _advance_adjustment; }
+    
+    // Pen advance of a single character in native units, 0 if missing
+    int get_advance(char c) const {
+        auto fc = lookup(c);
+        return fc ? fc->xadvance - _advance_adjustment : 0;
+    }
+    
+    int get_line_height() const { return _line_height; }
 	
+    // The texture is uploaded on the first call, on the render thread
     void begin() const;
     void end() const;
 
 	~FontLoader();
 	
 private:
+    static int kerning_key(char a, char b) {
+        return ((unsigned char)a << 8) | (unsigned char)b;
+    }
+    
     std::unordered_map<char, FontCharacter> _chars;
-    std::unordered_map<std::string, int> _kerning;
+    std::unordered_map<int, int> _kerning;
     
 	int _texture_size;
     int _size;
 	int _advance_adjustment;
-    unsigned int _texture_id;
+    int _line_height = 0;
+    
+    mutable std::vector<unsigned char> _pixels;
+    int _pixels_width = 0;
+    int _pixels_height = 0;
+    mutable unsigned int _texture_id = 0;
 };
 
 class Font : public BindableObjectBase
@@ -146,7 +211,7 @@ public:
         {
             _loader.reset(new FontLoader(src));
             _src = src;
-            fire_property_change("src");
+            fire_property_change(PropertyName("src"));
         }
     }
     
@@ -0,0 +1,323 @@
+#include "input.h"
+#include "ui.h"
+
+#include <thread>
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+    const char recording_magic[4] = { 'U', 'I', 'I', 'N' };
+    const unsigned char recording_version = 1;
+
+    enum RecordKind : unsigned char
+    {
+        record_move,
+        record_button,
+        record_scroll,
+        record_frame_end,
+        record_key,
+        record_char
+    };
+
+    IKeyboardTarget* keyboard_target = nullptr;
+    bool click_claimed = false;
+}
+
+IKeyboardTarget* KeyboardFocus::get()
+{
+    return keyboard_target;
+}
+
+void KeyboardFocus::set(IKeyboardTarget* target)
+{
+    click_claimed = true;
+    if (target == keyboard_target) return;
+
+    auto previous = keyboard_target;
+    keyboard_target = target;
+    if (previous) previous->set_keyboard_focus(false);
+    if (target) target->set_keyboard_focus(true);
+}
+
+void KeyboardFocus::release(IKeyboardTarget* target)
+{
+    if (keyboard_target == target) keyboard_target = nullptr;
+}
+
+void KeyboardFocus::begin_click()
+{
+    click_claimed = false;
+}
+
+void KeyboardFocus::end_click()
+{
+    if (!click_claimed) set(nullptr);
+}
+
+void InputQueue::push(const InputEvent& e)
+{
+    _received++;
+    if (_recorder) _recorder->record(e);
+
+    if (e.type == InputEventType::move && !_events.empty() &&
+        _events.back().type == InputEventType::move)
+    {
+        _events.back() = e;
+    }
+    else
+    {
+        _events.push_back(e);
+    }
+}
+
+void InputQueue::push_move(Int2 cursor)
+{
+    push({ InputEventType::move, cursor, MouseButton::left, MouseState::up });
+}
+
+void InputQueue::push_button(MouseButton button, MouseState state)
+{
+    push({ InputEventType::button, { 0, 0 }, button, state });
+}
+
+void InputQueue::push_scroll(Int2 scroll)
+{
+    push({ InputEventType::scroll, scroll, MouseButton::left, MouseState::up });
+}
+
+void InputQueue::push_key(Key key, bool shift, bool control)
+{
+    InputEvent e { InputEventType::key, { 0, 0 }, MouseButton::left, MouseState::up };
+    e.key = key;
+    e.shift = shift;
+    e.control = control;
+    push(e);
+}
+
+void InputQueue::push_char(unsigned int codepoint)
+{
+    InputEvent e { InputEventType::character, { 0, 0 }, MouseButton::left, MouseState::up };
+    e.codepoint = codepoint;
+    push(e);
+}
+
+void InputQueue::deliver(IVisualElement* root, const InputEvent& e)
+{
+    switch (e.type)
+    {
+    case InputEventType::move:
+        root->update_mouse_position(e.value); break;
+    case InputEventType::button:
+        if (e.state == MouseState::down)
+        {
+            // a press outside of the keyboard target takes its focus away
+            KeyboardFocus::begin_click();
+            root->update_mouse_state(e.button, e.state);
+            KeyboardFocus::end_click();
+        }
+        else
+        {
+            root->update_mouse_state(e.button, e.state);
+        }
+        break;
+    case InputEventType::scroll:
+        root->update_mouse_scroll(e.value); break;
+    case InputEventType::key:
+        if (auto target = KeyboardFocus::get())
+            target->update_key(e.key, e.shift, e.control);
+        break;
+    case InputEventType::character:
+        if (auto target = KeyboardFocus::get())
+            target->update_char(e.codepoint);
+        break;
+    }
+}
+
+void InputQueue::take_pending(std::vector<InputEvent>& events)
+{
+    if (_recorder) _recorder->record_frame();
+
+    // the buffers are swapped, so neither of them reallocates in steady state
+    events.clear();
+    std::swap(events, _events);
+    _dispatched += events.size();
+}
+
+void InputQueue::dispatch(IVisualElement* root)
+{
+    take_pending(_dispatching);
+    for (auto& e : _dispatching) deliver(root, e);
+}
+
+InputRecorder::InputRecorder(const std::string& filename)
+    : _file(filename, ios::binary), _last(chrono::high_resolution_clock::now())
+{
+    if (!_file)
+        throw std::runtime_error(str() << "Can't open " << filename << " for recording!");
+
+    _file.write(recording_magic, sizeof(recording_magic));
+    write(recording_version);
+}
+
+void InputRecorder::write_header(unsigned char kind)
+{
+    auto now = chrono::high_resolution_clock::now();
+    auto delta = chrono::duration_cast<chrono::microseconds>(now - _last).count();
+    _last = now;
+
+    write(kind);
+    write((unsigned int)delta);
+    _count++;
+}
+
+void InputRecorder::record(const InputEvent& e)
+{
+    switch (e.type)
+    {
+    case InputEventType::move:
+    case InputEventType::scroll:
+        write_header(e.type == InputEventType::move ? record_move : record_scroll);
+        write((int)e.value.x);
+        write((int)e.value.y);
+        break;
+    case InputEventType::button:
+        write_header(record_button);
+        write((unsigned char)e.button);
+        write((unsigned char)e.state);
+        break;
+    case InputEventType::key:
+        write_header(record_key);
+        write((unsigned char)e.key);
+        write((unsigned char)((e.shift ? 1 : 0) | (e.control ? 2 : 0)));
+        break;
+    case InputEventType::character:
+        write_header(record_char);
+        write(e.codepoint);
+        break;
+    }
+}
+
+void InputRecorder::record_frame()
+{
+    write_header(record_frame_end);
+}
+
+std::vector<RecordedInput> load_recording(const std::string& filename)
+{
+    ifstream file(filename, ios::binary);
+    if (!file)
+        throw std::runtime_error(str() << "Recording " << filename << " not found!");
+
+    auto read = [&file](auto& value) {
+        file.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return (bool)file;
+    };
+
+    char magic[4];
+    unsigned char version;
+    file.read(magic, sizeof(magic));
+    if (!file || !equal(magic, magic + 4, recording_magic) ||
+        !read(version) || version != recording_version)
+        throw std::runtime_error(str() << filename << " is not an input recording!");
+
+    std::vector<RecordedInput> records;
+    long long time = 0;
+    unsigned char kind;
+    unsigned int delta;
+    while (read(kind))
+    {
+        if (!read(delta)) break;
+        time += delta;
+
+        RecordedInput r { time, false,
+                          { InputEventType::move, { 0, 0 },
+                            MouseButton::left, MouseState::up } };
+        int x, y;
+        unsigned char button, state, key, mods;
+        unsigned int codepoint;
+        switch (kind)
+        {
+        case record_move:
+        case record_scroll:
+            if (!read(x) || !read(y)) return records;
+            r.event.type = (kind == record_move) ? InputEventType::move
+                                                 : InputEventType::scroll;
+            r.event.value = { x, y };
+            break;
+        case record_button:
+            if (!read(button) || !read(state)) return records;
+            r.event.type = InputEventType::button;
+            r.event.button = (MouseButton)button;
+            r.event.state = (MouseState)state;
+            break;
+        case record_key:
+            if (!read(key) || !read(mods)) return records;
+            r.event.type = InputEventType::key;
+            r.event.key = (Key)key;
+            r.event.shift = (mods & 1) != 0;
+            r.event.control = (mods & 2) != 0;
+            break;
+        case record_char:
+            if (!read(codepoint)) return records;
+            r.event.type = InputEventType::character;
+            r.event.codepoint = codepoint;
+            break;
+        case record_frame_end:
+            r.frame = true;
+            break;
+        default:
+            throw std::runtime_error(str() << filename << " is corrupted!");
+        }
+        records.push_back(r);
+    }
+    return records;
+}
+
+InputReplay::InputReplay(std::vector<RecordedInput> records)
+    : _records(move(records))
+{
+}
+
+int InputReplay::get_event_count() const
+{
+    return (int)count_if(_records.begin(), _records.end(),
+                         [](const RecordedInput& r) { return !r.frame; });
+}
+
+bool InputReplay::next_frame(InputQueue& queue, bool realtime)
+{
+    if (_next >= (int)_records.size()) return false;
+
+    if (!_playing)
+    {
+        _started = chrono::high_resolution_clock::now();
+        _playing = true;
+    }
+
+    // a recording cut short still delivers what it has as a last frame
+    auto end = _next;
+    while (end < (int)_records.size() && !_records[end].frame) end++;
+
+    if (realtime)
+    {
+        auto& last = _records[min(end, (int)_records.size() - 1)];
+        this_thread::sleep_until(_started + chrono::microseconds(last.time_us));
+    }
+
+    for (; _next < end; _next++)
+    {
+        auto& e = _records[_next].event;
+        switch (e.type)
+        {
+        case InputEventType::move: queue.push_move(e.value); break;
+        case InputEventType::button: queue.push_button(e.button, e.state); break;
+        case InputEventType::scroll: queue.push_scroll(e.value); break;
+        case InputEventType::key: queue.push_key(e.key, e.shift, e.control); break;
+        case InputEventType::character: queue.push_char(e.codepoint); break;
+        }
+    }
+    _next = end + 1;
+    return true;
+}
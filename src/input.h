@@ -0,0 +1,158 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <chrono>
+
+#include "types.h"
+
+class IVisualElement;
+class InputRecorder;
+
+enum class InputEventType
+{
+    move,
+    button,
+    scroll,
+    key,
+    character
+};
+
+struct InputEvent
+{
+    InputEventType type;
+    Int2 value;
+    MouseButton button;
+    MouseState state;
+    Key key = Key::unknown;
+    bool shift = false;
+    bool control = false;
+    unsigned int codepoint = 0;
+};
+
+// Receives the keyboard while it holds the keyboard focus
+class IKeyboardTarget
+{
+public:
+    virtual void update_key(Key key, bool shift, bool control) = 0;
+    virtual void update_char(unsigned int codepoint) = 0;
+    virtual void set_keyboard_focus(bool on) = 0;
+
+    virtual ~IKeyboardTarget() {}
+};
+
+// The single owner of the keyboard
+// A target claims it when clicked, a click nobody claims takes it away
+class KeyboardFocus
+{
+public:
+    static IKeyboardTarget* get();
+
+    // The previous target is told it lost the focus
+    static void set(IKeyboardTarget* target);
+
+    // Drops the focus without notifying, for targets being destroyed
+    static void release(IKeyboardTarget* target);
+
+    static void begin_click();
+    static void end_click();
+};
+
+// Buffers mouse input between frames
+// Consecutive cursor moves collapse into the last one, since only the final
+// position matters for hit testing. Buttons and scrolls are kept as they are,
+// in the order they arrived, with the cursor position that preceded them
+class InputQueue
+{
+public:
+    void push_move(Int2 cursor);
+    void push_button(MouseButton button, MouseState state);
+    void push_scroll(Int2 scroll);
+    void push_key(Key key, bool shift, bool control);
+    void push_char(unsigned int codepoint);
+
+    // Delivers everything queued since the last call to the root
+    // Events pushed by the handlers themselves wait for the next frame
+    void dispatch(IVisualElement* root);
+
+    // Moves the queued events out, for callers dispatching them one by one
+    void take_pending(std::vector<InputEvent>& events);
+
+    static void deliver(IVisualElement* root, const InputEvent& e);
+
+    int get_pending() const { return (int)_events.size(); }
+
+    long long get_received() const { return _received; }
+    long long get_dispatched() const { return _dispatched; }
+
+    // Every event pushed, before coalescing, and every frame
+    // boundary is also written to the recorder, if there is one
+    void set_recorder(InputRecorder* recorder) { _recorder = recorder; }
+
+private:
+    void push(const InputEvent& e);
+
+    std::vector<InputEvent> _events;
+    std::vector<InputEvent> _dispatching;
+    long long _received = 0;
+    long long _dispatched = 0;
+    InputRecorder* _recorder = nullptr;
+};
+
+// One entry of a recording, either an event or the end of a frame
+struct RecordedInput
+{
+    long long time_us;
+    bool frame;
+    InputEvent event;
+};
+
+// Writes the input stream into a compact binary file
+// Every record is a kind byte and the microseconds since the previous
+// record, followed by the coordinates, the button and its state, or the key
+class InputRecorder
+{
+public:
+    explicit InputRecorder(const std::string& filename);
+
+    void record(const InputEvent& e);
+    void record_frame();
+
+    long long get_count() const { return _count; }
+
+private:
+    void write_header(unsigned char kind);
+
+    template<class T>
+    void write(T value)
+    {
+        _file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    std::ofstream _file;
+    std::chrono::high_resolution_clock::time_point _last;
+    long long _count = 0;
+};
+
+std::vector<RecordedInput> load_recording(const std::string& filename);
+
+// Plays a recording back into a queue, one recorded frame at a time
+class InputReplay
+{
+public:
+    explicit InputReplay(std::vector<RecordedInput> records);
+
+    // Pushes the events of the next frame, returns false once the
+    // recording is over. In real time it first waits until the moment
+    // the frame ended during recording, otherwise it never waits
+    bool next_frame(InputQueue& queue, bool realtime);
+
+    int get_event_count() const;
+
+private:
+    std::vector<RecordedInput> _records;
+    int _next = 0;
+    std::chrono::high_resolution_clock::time_point _started;
+    bool _playing = false;
+};
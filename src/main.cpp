@@ -1,6 +1,8 @@
 #include <memory>
 #include <chrono>
 #include <cmath>
+#include <thread>
+#include <fstream>
 
 #include "ui.h"
 #include "controls.h"
@@ -8,6 +10,9 @@
 #include "serializer.h"
 #include "font.h"
 #include "flat2d.h"
+#include "parallel.h"
+#include "input.h"
+#include "profiler.h"
 
 #ifdef WIN32
 #define USEGLEW
@@ -32,7 +37,7 @@ struct FloatCounter : public BindableObjectBase
     void update()
     {
         count += _sign * 0.22f;
-        fire_property_change("count");
+        fire_property_change(PropertyName("count"));
     }
     
     std::shared_ptr<ITypeDefinition> make_type_definition() const override
@@ -55,7 +60,7 @@ struct IntCounter : public BindableObjectBase
     void update()
     {
         count += _sign;
-        fire_property_change("count");
+        fire_property_change(PropertyName("count"));
     }
     
     std::shared_ptr<ITypeDefinition> make_type_definition() const override
@@ -83,19 +88,19 @@ struct Context : public BindableObjectBase
     void set_int_mode()
     {
         counter = ints_counter;
-        fire_property_change("counter");
+        fire_property_change(PropertyName("counter"));
     }
     
     void set_float_mode()
     {
         counter = floats_counter;
-        fire_property_change("counter");
+        fire_property_change(PropertyName("counter"));
     }
     
     void set_null()
     {
         counter = nullptr;
-        fire_property_change("counter");
+        fire_property_change(PropertyName("counter"));
     }
     
     void update_fps()
@@ -113,7 +118,7 @@ struct Context : public BindableObjectBase
         if (_frame_times.size() != fps)
         {
             fps = _frame_times.size();
-            fire_property_change("fps");
+            fire_property_change(PropertyName("fps"));
         }
     }
     
@@ -265,6 +270,29 @@ void setup_ui(IVisualElement* c, shared_ptr<INotifyPropertyChanged> dcPlus,
 
 int main(int argc, char * argv[]) try
 {
+    string record_file;
+    string profile_file;
+    auto deferred_changes = true;
+    for (auto i = 1; i < argc; i++)
+    {
+        if (string(argv[i]) == "--parallel-layout")
+        {
+            ParallelLayout::enable(thread::hardware_concurrency());
+        }
+        else if (string(argv[i]) == "--record" && i + 1 < argc)
+        {
+            record_file = argv[++i];
+        }
+        else if (string(argv[i]) == "--sync-changes")
+        {
+            deferred_changes = false;
+        }
+        else if (string(argv[i]) == "--profile-bindings" && i + 1 < argc)
+        {
+            profile_file = argv[++i];
+            BindingProfiler::enable();
+        }
+    }
 
     glfwInit();
     GLFWwindow * win = glfwCreateWindow(800, 600, "main", 0, 0);
@@ -318,19 +346,31 @@ int main(int argc, char * argv[]) try
         ctx.flat2d_renderer = &flat_render;
         c.set_render_context(ctx);
 
-        glfwSetWindowUserPointer(win, &c);
+        // input is queued by the callbacks and delivered once per frame
+        InputQueue input;
+        
+        // the session can be replayed headless with "bench --replay"
+        unique_ptr<InputRecorder> recorder;
+        if (!record_file.empty())
+        {
+            recorder.reset(new InputRecorder(record_file));
+            input.set_recorder(recorder.get());
+            LOG(INFO) << "Recording input to " << record_file;
+        }
+
+        glfwSetWindowUserPointer(win, &input);
         glfwSetCursorPosCallback(win, [](GLFWwindow * w, double x, double y) {
-            auto ui_element = (IVisualElement*)glfwGetWindowUserPointer(w);
-            ui_element->update_mouse_position({ (int)x, (int)y });
+            auto queue = (InputQueue*)glfwGetWindowUserPointer(w);
+            queue->push_move({ (int)x, (int)y });
         });
         glfwSetScrollCallback(win, [](GLFWwindow * w, double x, double y) {
-            auto ui_element = (IVisualElement*)glfwGetWindowUserPointer(w);
-            ui_element->update_mouse_scroll({ (int)x, (int)y });
+            auto queue = (InputQueue*)glfwGetWindowUserPointer(w);
+            queue->push_scroll({ (int)x, (int)y });
         });
         glfwSetMouseButtonCallback(win, [](GLFWwindow * w, 
                                            int button, int action, int mods)
         {
-            auto ui_element = (IVisualElement*)glfwGetWindowUserPointer(w);
+            auto queue = (InputQueue*)glfwGetWindowUserPointer(w);
             MouseButton button_type;
             switch(button)
             {
@@ -357,12 +397,46 @@ int main(int argc, char * argv[]) try
                 mouse_state = MouseState::up;
             };
 
-            ui_element->update_mouse_state(button_type, mouse_state);
+            queue->push_button(button_type, mouse_state);
+        });
+        glfwSetKeyCallback(win, [](GLFWwindow * w, 
+                                   int key, int scancode, int action, int mods)
+        {
+            if (action == GLFW_RELEASE) return;
+            
+            auto queue = (InputQueue*)glfwGetWindowUserPointer(w);
+            Key key_type;
+            switch(key)
+            {
+            case GLFW_KEY_LEFT: key_type = Key::left; break;
+            case GLFW_KEY_RIGHT: key_type = Key::right; break;
+            case GLFW_KEY_HOME: key_type = Key::home; break;
+            case GLFW_KEY_END: key_type = Key::end; break;
+            case GLFW_KEY_BACKSPACE: key_type = Key::backspace; break;
+            case GLFW_KEY_DELETE: key_type = Key::del; break;
+            case GLFW_KEY_ENTER: key_type = Key::enter; break;
+            case GLFW_KEY_KP_ENTER: key_type = Key::enter; break;
+            case GLFW_KEY_ESCAPE: key_type = Key::escape; break;
+            case GLFW_KEY_A: key_type = Key::a; break;
+            default:
+                return;
+            };
+
+            queue->push_key(key_type, (mods & GLFW_MOD_SHIFT) != 0, 
+                            (mods & GLFW_MOD_CONTROL) != 0);
         });
+        glfwSetCharCallback(win, [](GLFWwindow * w, unsigned int codepoint) {
+            auto queue = (InputQueue*)glfwGetWindowUserPointer(w);
+            queue->push_char(codepoint);
+        });
+        
+        // from here on changes are propagated once per frame
+        ChangeDispatcher::set_deferred(deferred_changes);
         
         while (!glfwWindowShouldClose(win))
         {
             glfwPollEvents();
+            input.dispatch(&c);
 
             int w,h;
             glfwGetFramebufferSize(win, &w, &h);
@@ -375,6 +449,7 @@ int main(int argc, char * argv[]) try
 
             dcPlus->update();
             dcMinus->update();
+            ChangeDispatcher::flush();
 
             Rect origin { { 0, 0 }, { w, h } };
 
@@ -382,6 +457,16 @@ int main(int argc, char * argv[]) try
 
             glfwSwapBuffers(win);
         }
+        
+        LOG(INFO) << "Input events received: " << input.get_received()
+                  << ", dispatched: " << input.get_dispatched();
+        
+        if (!profile_file.empty())
+        {
+            ofstream profile(profile_file);
+            BindingProfiler::write_json(profile);
+            LOG(INFO) << "Binding profile written to " << profile_file;
+        }
     }
 
     glfwDestroyWindow(win);
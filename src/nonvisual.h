@@ -21,7 +21,7 @@ public:
         if (elapsed != _elapsed)
         {
             _elapsed = elapsed;
-            fire_property_change("elapsed");
+            fire_property_change(PropertyName("elapsed"));
         }
     }
     
@@ -38,3 +38,53 @@ struct TypeDefinition<Timer>
         DefineClass(Timer)->AddField(get_elapsed);
     }
 };
+
+struct SequenceItem : public BindableObjectBase
+{
+    int index = 0;
+    std::string text = "";
+};
+
+template<>
+struct TypeDefinition<SequenceItem>
+{
+    static std::shared_ptr<ITypeDefinition> make() 
+    {
+        DefineClass(SequenceItem)->AddField(index)->AddField(text);
+    }
+};
+
+// Virtual collection of numbered items, created only when requested
+class Sequence : public BindableObjectBase, public IItemsSource
+{
+public:
+    int get_count() const override { return _count; }
+    void set_count(int count)
+    {
+        if (count != _count)
+        {
+            _count = count;
+            fire_property_change(PropertyName("count"));
+        }
+    }
+    
+    std::shared_ptr<INotifyPropertyChanged> get_item(int index) override
+    {
+        auto item = std::make_shared<SequenceItem>();
+        item->index = index;
+        item->text = str() << "item #" << index;
+        return item;
+    }
+    
+private:
+    int _count = 0;
+};
+
+template<>
+struct TypeDefinition<Sequence>
+{
+    static std::shared_ptr<ITypeDefinition> make() 
+    {
+        DefineClass(Sequence)->AddProperty(get_count, set_count);
+    }
+};
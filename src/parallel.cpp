@@ -0,0 +1,209 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+namespace
+{
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local int current_queue = 0;
+
+    unique_ptr<ThreadPool> layout_pool;
+    int layout_threshold = 16;
+    thread_local int layout_tasks = 0;
+
+    // waking the pool and joining it back costs tens of microseconds,
+    // less work than this is done faster by the calling thread alone
+    const chrono::microseconds min_parallel_work(200);
+
+    struct LayoutTask
+    {
+        LayoutTask() { layout_tasks++; }
+        ~LayoutTask() { layout_tasks--; }
+    };
+}
+
+ThreadPool::ThreadPool(int threads)
+    : _queued(0), _stop(false)
+{
+    // the last queue is shared by the threads outside of the pool
+    for (auto i = 0; i <= threads; i++)
+    {
+        _queues.emplace_back(new Queue());
+    }
+    for (auto i = 0; i < threads; i++)
+    {
+        _threads.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    _stop = true;
+    {
+        lock_guard<mutex> lock(_sleep_lock);
+    }
+    _wake.notify_all();
+
+    for (auto& t : _threads) t.join();
+}
+
+int ThreadPool::get_queue_index() const
+{
+    if (current_pool == this) return current_queue;
+    return (int)_queues.size() - 1;
+}
+
+void ThreadPool::push(int queue, Task task)
+{
+    {
+        lock_guard<mutex> lock(_queues[queue]->lock);
+        _queues[queue]->tasks.push_back(move(task));
+    }
+    _queued++;
+
+    // taking the lock orders this with a worker about to go to sleep
+    {
+        lock_guard<mutex> lock(_sleep_lock);
+    }
+    _wake.notify_one();
+}
+
+bool ThreadPool::try_run(int queue)
+{
+    Task task;
+    {
+        auto& own = *_queues[queue];
+        lock_guard<mutex> lock(own.lock);
+        if (!own.tasks.empty())
+        {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+
+    for (size_t i = 1; !task && i < _queues.size(); i++)
+    {
+        auto& other = *_queues[(queue + i) % _queues.size()];
+        lock_guard<mutex> lock(other.lock);
+        if (!other.tasks.empty())
+        {
+            task = move(other.tasks.front());
+            other.tasks.pop_front();
+        }
+    }
+
+    if (!task) return false;
+
+    _queued--;
+    task();
+    return true;
+}
+
+void ThreadPool::worker_loop(int index)
+{
+    current_pool = this;
+    current_queue = index;
+
+    while (!_stop)
+    {
+        if (try_run(index)) continue;
+
+        unique_lock<mutex> lock(_sleep_lock);
+        _wake.wait(lock, [this]() { return _stop || _queued > 0; });
+    }
+}
+
+void ThreadPool::parallel_for(int count, const function<void(int)>& body)
+{
+    if (count <= 0) return;
+
+    // a few chunks per thread, so that stealing evens out uneven subtrees
+    auto chunks = min(count, (get_thread_count() + 1) * 4);
+    atomic<int> pending(chunks);
+    exception_ptr error;
+    mutex error_lock;
+
+    auto self = get_queue_index();
+    for (auto c = 0; c < chunks; c++)
+    {
+        auto from = (int)((long long)count * c / chunks);
+        auto to = (int)((long long)count * (c + 1) / chunks);
+
+        push(self, [&, from, to]() {
+            try
+            {
+                for (auto i = from; i < to; i++) body(i);
+            }
+            catch (...)
+            {
+                lock_guard<mutex> lock(error_lock);
+                if (!error) error = current_exception();
+            }
+            pending--;
+        });
+    }
+
+    // help out instead of blocking, our own tasks may be waiting in the queues
+    while (pending > 0)
+    {
+        if (!try_run(self)) this_thread::yield();
+    }
+
+    if (error) rethrow_exception(error);
+}
+
+void ParallelLayout::enable(int threads, int threshold)
+{
+    // the calling thread takes part in every loop
+    layout_pool.reset(threads > 1 ? new ThreadPool(threads - 1) : nullptr);
+    layout_threshold = max(threshold, 1);
+}
+
+void ParallelLayout::disable()
+{
+    layout_pool.reset();
+}
+
+bool ParallelLayout::is_enabled()
+{
+    return layout_pool.get() != nullptr;
+}
+
+int ParallelLayout::get_threshold()
+{
+    return layout_threshold;
+}
+
+bool ParallelLayout::in_task()
+{
+    return layout_tasks > 0;
+}
+
+void ParallelLayout::fan_out(int count, const function<void(int)>& body)
+{
+    typedef chrono::steady_clock Clock;
+
+    // the first items estimate the cost of the rest, checking the clock
+    // after 1, 2, 4... of them so that cheap loops don't pay for it
+    auto start = Clock::now();
+    auto done = 0;
+    auto next_check = 1;
+    while (done < count)
+    {
+        body(done++);
+        if (done < next_check) continue;
+        next_check *= 2;
+
+        auto elapsed = Clock::now() - start;
+        if (elapsed * (count - done) / done >= min_parallel_work) break;
+    }
+    if (done == count) return;
+
+    layout_pool->parallel_for(count - done, [&](int i) {
+        LayoutTask task;
+        body(done + i);
+    });
+}
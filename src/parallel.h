@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+// Work-stealing pool for fork-join loops
+// Every worker owns a queue, taking work from its back and stealing from
+// the front of the others. A thread waiting for its loop to complete keeps
+// running pending tasks, so loops can be nested inside of loop bodies
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int get_thread_count() const { return (int)_threads.size(); }
+
+    // Runs body(i) for every i in [0, count) and returns once all are done
+    // The first exception thrown by the body is rethrown to the caller
+    void parallel_for(int count, const std::function<void(int)>& body);
+
+private:
+    typedef std::function<void()> Task;
+
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    void worker_loop(int index);
+    int get_queue_index() const;
+
+    void push(int queue, Task task);
+    bool try_run(int queue);
+
+    std::vector<std::thread> _threads;
+    std::vector<std::unique_ptr<Queue>> _queues;
+
+    std::atomic<int> _queued;
+    std::atomic<bool> _stop;
+    std::mutex _sleep_lock;
+    std::condition_variable _wake;
+};
+
+// Global switch for laying out sibling subtrees in parallel
+// Only the measurement of siblings is fanned out, results are stored per
+// index and combined in order, so the rects match the serial path exactly.
+// Measuring is read-only (text sizes come from the font metrics), so
+// it is safe as long as nothing renders concurrently with the layout pass.
+// State that is filled lazily (font textures, text metrics, page sizes)
+// is only written by render and change callbacks, never by a task. The
+// column sizes of a Grid are the exception, they are filled under a lock
+class ParallelLayout
+{
+public:
+    static void enable(int threads, int threshold = 16);
+    static void disable();
+
+    static bool is_enabled();
+    static int get_threshold();
+
+    // True while running a fanned out loop body, on any thread
+    static bool in_task();
+
+    // Runs body(i) for every i in [0, count)
+    // Loops of at least threshold items time their first items on the
+    // calling thread, and only hand the rest to the pool if it is enough
+    // work to be worth waking it. Each task then takes whole subtrees,
+    // the loops nested inside of them run serially
+    template<class F>
+    static void for_each(int count, const F& body)
+    {
+        if (count < get_threshold() || !is_enabled() || in_task())
+        {
+            for (auto i = 0; i < count; i++) body(i);
+        }
+        else
+        {
+            fan_out(count, std::cref(body));
+        }
+    }
+
+private:
+    static void fan_out(int count, const std::function<void(int)>& body);
+};
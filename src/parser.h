@@ -391,6 +391,14 @@ namespace type_string_traits
         else return "unknown";
     }
 
+    template<>
+    inline std::string to_string(UpdateTrigger s)
+    {
+        if (s == UpdateTrigger::keystroke) return "keystroke";
+        else if (s == UpdateTrigger::commit) return "commit";
+        else return "unknown";
+    }
+
     template<>
     inline int parse(const std::string& str, int*)
     {
@@ -464,6 +472,18 @@ namespace type_string_traits
         throw std::runtime_error(ss.str());
     }
     
+    template<>
+    inline UpdateTrigger parse(const std::string& str, UpdateTrigger*)
+    {
+        if (str == "") return UpdateTrigger::keystroke;
+        
+        auto s = to_lower(str);
+        if (s == "keystroke") return UpdateTrigger::keystroke;
+        if (s == "commit") return UpdateTrigger::commit;
+        std::stringstream ss; ss << "Invalid UpdateTrigger '" << str << "'";
+        throw std::runtime_error(ss.str());
+    }
+    
     
     template<class T>
     inline std::string type_to_string(T* input);
@@ -482,6 +502,7 @@ namespace type_string_traits
     DECLARE_TYPE_NAME(Color3);
     DECLARE_TYPE_NAME(Orientation);
     DECLARE_TYPE_NAME(Alignment);
+    DECLARE_TYPE_NAME(UpdateTrigger);
     DECLARE_TYPE_NAME(INotifyPropertyChanged*);
     DECLARE_TYPE_NAME(std::shared_ptr<INotifyPropertyChanged>);
 };
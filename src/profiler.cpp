@@ -0,0 +1,225 @@
+#include "profiler.h"
+#include "bind.h"
+
+#include "../easyloggingpp/easylogging++.h"
+
+#include <unordered_map>
+#include <map>
+#include <mutex>
+#include <algorithm>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+std::atomic<bool> BindingProfiler::_enabled(false);
+std::atomic<bool> BindingProfiler::_has_records(false);
+
+namespace
+{
+    struct Record
+    {
+        BindingStats stats;
+        long long last_cascade = -1;
+        bool last_a_to_b = false;
+    };
+
+    struct Frame
+    {
+        const Binding* binding;
+        bool a_to_b;
+        Clock::time_point start;
+        long long nested_ns;
+        long long converter_ns;
+        long long string_fallbacks;
+        int deepest;
+        bool reentered;
+    };
+
+    mutex stats_lock;
+    unordered_map<const Binding*, Record> live_records;
+    map<string, BindingStats> retired_records;
+    Clock::time_point started = Clock::now();
+    atomic<long long> next_cascade(0);
+
+    thread_local vector<Frame> frames;
+    thread_local long long current_cascade = 0;
+
+    void merge(BindingStats& into, const BindingStats& from)
+    {
+        into.updates += from.updates;
+        into.update_ms += from.update_ms;
+        into.converter_ms += from.converter_ms;
+        into.string_fallbacks += from.string_fallbacks;
+        into.cascades += from.cascades;
+        into.max_cascade_depth = max(into.max_cascade_depth, from.max_cascade_depth);
+        into.ping_pongs += from.ping_pongs;
+    }
+
+    string escape(const string& s)
+    {
+        string res;
+        for (auto c : s)
+        {
+            if (c == '"' || c == '\\') res += '\\';
+            if ((unsigned char)c < 0x20) res += ' ';
+            else res += c;
+        }
+        return res;
+    }
+}
+
+void BindingProfiler::enable()
+{
+    if (!is_enabled()) reset();
+    _enabled = true;
+}
+
+void BindingProfiler::disable()
+{
+    _enabled = false;
+}
+
+void BindingProfiler::reset()
+{
+    lock_guard<mutex> lock(stats_lock);
+    live_records.clear();
+    retired_records.clear();
+    _has_records = false;
+    started = Clock::now();
+}
+
+void BindingProfiler::begin(const Binding* binding, bool a_to_b)
+{
+    if (frames.empty()) current_cascade = next_cascade++;
+
+    auto reentered = false;
+    for (auto& f : frames) reentered |= f.binding == binding;
+
+    auto depth = (int)frames.size();
+    frames.push_back({ binding, a_to_b, Clock::now(), 0, 0, 0, depth, reentered });
+}
+
+void BindingProfiler::end()
+{
+    auto frame = frames.back();
+    frames.pop_back();
+
+    auto level = (int)frames.size();
+    auto elapsed = chrono::duration_cast<chrono::nanoseconds>(
+        Clock::now() - frame.start).count();
+    if (!frames.empty())
+    {
+        frames.back().nested_ns += elapsed;
+        frames.back().deepest = max(frames.back().deepest, frame.deepest);
+    }
+
+    lock_guard<mutex> lock(stats_lock);
+    auto it = live_records.find(frame.binding);
+    if (it == live_records.end())
+    {
+        it = live_records.emplace(frame.binding, Record()).first;
+        it->second.stats.description = frame.binding->describe();
+        _has_records = true;
+    }
+
+    auto& r = it->second;
+    r.stats.updates++;
+    r.stats.update_ms += (elapsed - frame.nested_ns - frame.converter_ns) / 1e6;
+    r.stats.converter_ms += frame.converter_ns / 1e6;
+    r.stats.string_fallbacks += frame.string_fallbacks;
+    if (frame.deepest > level)
+    {
+        r.stats.cascades++;
+        r.stats.max_cascade_depth = max(r.stats.max_cascade_depth,
+                                        frame.deepest - level);
+    }
+
+    if (frame.reentered ||
+        (r.last_cascade == current_cascade && r.last_a_to_b != frame.a_to_b))
+    {
+        if (!r.stats.ping_pongs)
+        {
+            LOG(WARNING) << "Values go back and forth through the "
+                         << r.stats.description;
+        }
+        r.stats.ping_pongs++;
+    }
+    r.last_cascade = current_cascade;
+    r.last_a_to_b = frame.a_to_b;
+}
+
+bool BindingProfiler::in_update()
+{
+    return !frames.empty();
+}
+
+void BindingProfiler::add_converter_time(Clock::time_point start)
+{
+    if (frames.empty()) return;
+    frames.back().converter_ns += chrono::duration_cast<chrono::nanoseconds>(
+        Clock::now() - start).count();
+}
+
+void BindingProfiler::add_string_fallback()
+{
+    if (frames.empty()) return;
+    frames.back().string_fallbacks++;
+}
+
+void BindingProfiler::retire(const Binding* binding)
+{
+    lock_guard<mutex> lock(stats_lock);
+    auto it = live_records.find(binding);
+    if (it == live_records.end()) return;
+
+    auto& stats = it->second.stats;
+    auto& retired = retired_records[stats.description];
+    retired.description = stats.description;
+    retired.alive = false;
+    merge(retired, stats);
+    live_records.erase(it);
+}
+
+std::vector<BindingStats> BindingProfiler::get_stats()
+{
+    lock_guard<mutex> lock(stats_lock);
+
+    vector<BindingStats> res;
+    for (auto& r : live_records) res.push_back(r.second.stats);
+    for (auto& r : retired_records) res.push_back(r.second);
+
+    auto seconds = chrono::duration<double>(Clock::now() - started).count();
+    for (auto& s : res)
+    {
+        if (seconds > 0) s.updates_per_second = s.updates / seconds;
+    }
+
+    sort(res.begin(), res.end(), [](const BindingStats& x, const BindingStats& y) {
+        return x.update_ms + x.converter_ms > y.update_ms + y.converter_ms;
+    });
+    return res;
+}
+
+void BindingProfiler::write_json(std::ostream& out)
+{
+    auto stats = get_stats();
+
+    out << "{\n  \"bindings\": [";
+    for (auto i = 0; i < (int)stats.size(); i++)
+    {
+        auto& s = stats[i];
+        out << (i ? "," : "") << "\n    { "
+            << "\"description\": \"" << escape(s.description) << "\", "
+            << "\"alive\": " << (s.alive ? "true" : "false") << ", "
+            << "\"updates\": " << s.updates << ", "
+            << "\"updates_per_second\": " << s.updates_per_second << ", "
+            << "\"update_ms\": " << s.update_ms << ", "
+            << "\"converter_ms\": " << s.converter_ms << ", "
+            << "\"string_fallbacks\": " << s.string_fallbacks << ", "
+            << "\"cascades\": " << s.cascades << ", "
+            << "\"max_cascade_depth\": " << s.max_cascade_depth << ", "
+            << "\"ping_pongs\": " << s.ping_pongs << " }";
+    }
+    out << "\n  ]\n}\n";
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <atomic>
+#include <chrono>
+
+class Binding;
+
+// What one binding cost while the profiler was enabled
+// Bindings that were destroyed in the meantime are merged by description
+struct BindingStats
+{
+    std::string description;
+    bool alive = true;
+
+    long long updates = 0;
+    double updates_per_second = 0;
+    // getters, conversions and setters, without the nested updates they caused
+    double update_ms = 0;
+    double converter_ms = 0;
+    // values that went through get_value / set_value as strings
+    long long string_fallbacks = 0;
+
+    // updates that caused other binding updates, and how deep that went
+    long long cascades = 0;
+    int max_cascade_depth = 0;
+    // the binding ran again inside of its own cascade, or both of its
+    // directions ran within one: a TwoWay loop through other bindings
+    long long ping_pongs = 0;
+};
+
+// Per binding counters, collected only while enabled
+// Every update of a binding opens a scope on a per thread stack, so the
+// time of an update excludes the updates it triggered and the depth of
+// the stack is the depth of the cascade. When disabled a scope costs a
+// single relaxed load
+class BindingProfiler
+{
+public:
+    static void enable();
+    static void disable();
+    static bool is_enabled()
+    {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+    // Drops everything collected so far
+    static void reset();
+
+    // Most expensive first
+    static std::vector<BindingStats> get_stats();
+    static void write_json(std::ostream& out);
+
+    // Scope of one a_to_b / b_to_a of a binding
+    class Update
+    {
+    public:
+        Update(const Binding* binding, bool a_to_b)
+            : _active(is_enabled())
+        {
+            if (_active) begin(binding, a_to_b);
+        }
+        ~Update() { if (_active) end(); }
+
+    private:
+        bool _active;
+    };
+
+    // Scope of a converter applied inside of an update
+    class Converter
+    {
+    public:
+        Converter() : _active(is_enabled() && in_update())
+        {
+            if (_active) _start = std::chrono::steady_clock::now();
+        }
+        ~Converter() { if (_active) add_converter_time(_start); }
+
+    private:
+        bool _active;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    static void count_string_fallback()
+    {
+        if (is_enabled()) add_string_fallback();
+    }
+
+    // Called by bindings being destroyed, also after the profiler was
+    // disabled, so that no stats are left behind for a dead binding
+    static void forget(const Binding* binding)
+    {
+        if (_has_records.load(std::memory_order_relaxed)) retire(binding);
+    }
+
+private:
+    static void begin(const Binding* binding, bool a_to_b);
+    static void end();
+    static bool in_update();
+    static void add_converter_time(std::chrono::steady_clock::time_point start);
+    static void add_string_fallback();
+    static void retire(const Binding* binding);
+
+    static std::atomic<bool> _enabled;
+    static std::atomic<bool> _has_records;
+};
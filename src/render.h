@@ -1,5 +1,7 @@
 #pragma once
 
+#include "types.h"
+
 class FontRenderer;
 class Flat2dRenderer;
 
@@ -7,4 +9,7 @@ struct RenderContext
 {
     FontRenderer* font_renderer;
     Flat2dRenderer* flat2d_renderer;
-};
\ No newline at end of file
+    // Part of the layout currently on screen, set by scrolling containers
+    // Null when nothing above the element limits what is visible
+    const Rect* viewport = nullptr;
+};
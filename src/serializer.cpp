@@ -8,6 +8,8 @@
 #include <fstream>
 #include <streambuf>
 #include <iterator>
+#include <unordered_map>
+#include <mutex>
 
 using namespace std;
 using namespace rapidxml;
@@ -15,13 +17,11 @@ using namespace rapidxml;
 struct BindingDef
 {
     INotifyPropertyChanged* a;
-    string a_prop;
-    string b_name;
-    string b_prop;
-    string converter_name;
-    BindingMode mode;
+    PropertyId a_prop;
+    std::shared_ptr<const BindingExpression> expr;
 };
 
+
 template<class T, class S>
 class Dictionary : public TypeConverterBase<T, S>,
                    public BindableObjectBase
@@ -118,22 +118,6 @@ struct TypeDefinition<FloatDictionary>
     }
 };
 
-struct BindingBridge : public BindableObjectBase
-{
-    bool object_exists = false;
-    
-    std::shared_ptr<Binding> binding = nullptr;
-};
-
-template<>
-struct TypeDefinition<BindingBridge>
-{
-    static std::shared_ptr<ITypeDefinition> make() 
-    {
-        DefineClass(BindingBridge)->AddField(object_exists);
-    }
-};
-
 struct BindingOwner : public BindableObjectBase
 {
     std::shared_ptr<INotifyPropertyChanged> object;
@@ -148,132 +132,30 @@ struct TypeDefinition<BindingOwner>
     }
 };
 
-class BridgeConverter : public TypeConverterBase<std::shared_ptr<INotifyPropertyChanged>, bool>
+// Listed as the first base so the held object outlives the Binding
+// base-class destructor, which still unsubscribes from it
+template<class T>
+struct KeepAlive
 {
-public:
-    BridgeConverter(std::function<void(std::shared_ptr<INotifyPropertyChanged> x)> created,
-                    std::function<void()> destroyed)
-        : _created(created), _destroyed(destroyed)
-    {
-    }
-
-    bool convert_to(std::shared_ptr<INotifyPropertyChanged> x) const override
-    {
-        bool is_null = !x;
-        
-        if (x != last)
-        {
-            if (last) _destroyed();
-            if (x) _created(x);
-            last = x;
-        }
-    
-        return x.get();
-    }
-    std::shared_ptr<INotifyPropertyChanged> convert_from(bool x) const override
-    {
-        return nullptr;
-    }
-    
-private:
-    mutable bool _was_null = true;
-    mutable std::shared_ptr<INotifyPropertyChanged> last = nullptr;
-    std::function<void(std::shared_ptr<INotifyPropertyChanged> x)> _created;
-    std::function<void()> _destroyed;
+    KeepAlive(std::shared_ptr<T> kept) : kept(kept) {}
+    std::shared_ptr<T> kept;
 };
 
-class ExtendedBinding : public Binding
-{
-public:
-    ExtendedBinding(std::shared_ptr<TypeFactory> factory,
-        INotifyPropertyChanged* a, std::string a_prop,
-        INotifyPropertyChanged* b, std::string b_prop,
-        std::shared_ptr<ITypeConverter> converter,
-        BindingMode mode,
-        std::shared_ptr<BindingBridge> bridge)
-        : Binding(factory, a, a_prop, b, b_prop, mode, converter),
-          _bridge(bridge)
-    {
-    }
-    
-private:
-    std::shared_ptr<BindingBridge> _bridge;
-};
-
-class OwningBinding : public Binding
+class OwningBinding : private KeepAlive<BindingOwner>, public Binding
 {
 public:
     OwningBinding(std::shared_ptr<TypeFactory> factory,
-        INotifyPropertyChanged* a, std::string a_prop,
-        INotifyPropertyChanged* b, std::string b_prop,
+        INotifyPropertyChanged* a, PropertyId a_prop,
+        INotifyPropertyChanged* b, PropertyId b_prop,
         std::shared_ptr<BindingOwner> owner,
         BindingMode mode,
         std::shared_ptr<ITypeConverter> converter)
-        : Binding(factory, a, a_prop, b, b_prop, mode, converter),
-          _owner(owner)
+        : KeepAlive<BindingOwner>(owner),
+          Binding(factory, a, a_prop, b, b_prop, mode, converter)
     {
     }
-    
-private:
-    std::shared_ptr<BindingOwner> _owner;
 };
 
-std::unique_ptr<Binding> create_multilevel_binding(
-    std::shared_ptr<TypeFactory> factory,
-    INotifyPropertyChanged* a_ptr,
-    INotifyPropertyChanged* b_ptr,
-    const std::string& a_prop,
-    const std::string& b_prop,
-    BindingMode mode,
-    std::shared_ptr<ITypeConverter> converter
-    )
-{
-    std::unique_ptr<Binding> binding;
-    MinimalParser p(b_prop);
-    auto prop_name = p.get_id();
-    if (p.peek() == '.')
-    {
-        p.get();
-        auto prop_rest = p.rest();
-        p.req_eof();
-        
-        std::shared_ptr<BindingBridge> bridge(new BindingBridge());
-        std::weak_ptr<BindingBridge> weak(bridge);
-       
-        auto on_create = [factory, weak, a_ptr, mode,
-                          a_prop, prop_rest, converter](auto x)
-        {
-            auto b = weak.lock();
-            if (b)
-            {
-                b->binding = create_multilevel_binding(
-                    factory, a_ptr, x.get(), a_prop,
-                    prop_rest, mode, converter);
-            }
-        };
-        auto on_delete = [weak](){
-            auto b = weak.lock();
-            if (b)
-            {
-                b->binding = nullptr;
-            }
-        };
-        
-        std::unique_ptr<ITypeConverter> converter(
-            new BridgeConverter(on_create, on_delete));
-        
-        binding.reset(new ExtendedBinding(
-            factory, bridge.get(), "object_exists", b_ptr, prop_name,
-            std::move(converter), BindingMode::OneWay, bridge));
-    }
-    else
-    {
-        binding.reset(new Binding(factory, a_ptr, a_prop,
-                                  b_ptr, b_prop, mode, converter));
-    }
-    return binding;
-}
-
 std::shared_ptr<INotifyPropertyChanged> Serializer::deserialize()
 {
     if (!_factory.get())
@@ -283,37 +165,61 @@ std::shared_ptr<INotifyPropertyChanged> Serializer::deserialize()
 	        Button, 
 	        TextBlock, 
 	        Slider,
+	        TextBox,
 	        Panel,
 	        StackPanel,
 	        Grid,
 	        PageView,
+	        ListView,
+	        ScrollViewer,
 	        Timer,
+	        Sequence,
+	        SequenceItem,
             Font,
             FloatDictionary
 	        >());
     }
 
-    if (!_factory->find_type("BindingBridge"))
-    {
-        _factory->register_type<BindingBridge>();
-    }
     if (!_factory->find_type("BindingOwner"))
     {
         _factory->register_type<BindingOwner>();
     }
 
 
-    AttrBag bag;
+    return instantiate(nullptr, _doc->doc.first_node(), AttrBag());
+}
+
+std::shared_ptr<INotifyPropertyChanged> Serializer::instantiate(
+                                                    IVisualElement* parent,
+                                                    xml_node<>* node,
+                                                    const AttrBag& bag)
+{
+    // all invalidations caused by building the tree and applying the
+    // initial binding values are folded into a single one at the end
+    LayoutTransaction transaction;
+    
     BindingBag bindings;
     ElementsMap elements;
-    auto res = deserialize(nullptr, _doc.first_node(), bag, bindings, elements);
+    auto res = deserialize(parent, node, bag, bindings, elements);
     auto elem = dynamic_cast<IVisualElement*>(res.get());
+    
+    // every name is looked up in the tree once, however many bindings use it
+    std::unordered_map<PropertyId, IVisualElement*> found;
+    auto find = [&](PropertyId name) -> IVisualElement* {
+        if (!name.is_valid()) return nullptr;
+        auto it = found.find(name);
+        if (it != found.end()) return it->second;
+        return found[name] = elem->find_element(name.get_name());
+    };
+    
     for (auto& def : bindings)
     {
-        auto converter_obj = elem->find_element(def.converter_name);
+        auto& expr = *def.expr;
+        auto converter_obj = find(expr.converter);
         auto a_ptr = elements[def.a];
         auto a = dynamic_cast<ControlBase*>(def.a);
-        auto b_obj = elem->find_element(def.b_name);
+        auto b_obj = find(expr.element);
+        auto path = &expr.path;
         std::shared_ptr<INotifyPropertyChanged> b_ptr, converter_ptr;
         if (b_obj)
         {
@@ -323,20 +229,11 @@ std::shared_ptr<INotifyPropertyChanged> Serializer::deserialize()
         }
         else
         {
-            // assuming def.b_name is refering to a property of this
-            if (def.b_name != "this")
-            {
-                if (def.b_prop != "")
-                    def.b_prop = def.b_name + "." + def.b_prop;
-                else
-                    def.b_prop = def.b_name;
-            }
+            // assuming expr.element is refering to a property of this
+            if (expr.element != PropertyName("this")) path = &expr.self_path;
             b_ptr = a_ptr;
-            def.b_name = a->to_string();
         }
         
-        LOG(INFO) << "Creating binding to " << a->to_string() << "." 
-            << def.a_prop << " from " << def.b_name << "." << def.b_prop;
         if (converter_obj)
         {
             converter_ptr = elements[converter_obj];
@@ -344,23 +241,34 @@ std::shared_ptr<INotifyPropertyChanged> Serializer::deserialize()
             if (adaptor) converter_ptr = adaptor->get();
         }
             
-        if (def.b_prop == "")
+        if (path->empty())
         {
             auto owner = std::make_shared<BindingOwner>();
             owner->object = b_ptr;
             
             std::unique_ptr<Binding> binding(new OwningBinding(_factory, 
                                              a_ptr.get(), def.a_prop,
-                                             owner.get(), "object", owner, def.mode,
+                                             owner.get(), PropertyName("object"), 
+                                             owner, expr.mode,
                                              std::dynamic_pointer_cast<ITypeConverter>(converter_ptr)));
                         
             if (a) a->add_binding(std::move(binding));
         }
         else
         {
-            auto binding = create_multilevel_binding(
-                        _factory, a_ptr.get(), b_ptr.get(), def.a_prop, def.b_prop, def.mode,
-                        std::dynamic_pointer_cast<ITypeConverter>(converter_ptr));
+            std::unique_ptr<Binding> binding;
+            auto converter = std::dynamic_pointer_cast<ITypeConverter>(converter_ptr);
+            if (path->size() == 1)
+            {
+                binding.reset(new Binding(_factory, a_ptr.get(), def.a_prop,
+                                          b_ptr.get(), path->front(), 
+                                          expr.mode, converter));
+            }
+            else
+            {
+                binding.reset(new PathBinding(_factory, a_ptr.get(), def.a_prop,
+                                              b_ptr.get(), *path, expr.mode, converter));
+            }
             if (a) a->add_binding(std::move(binding));
         }
     }
@@ -369,13 +277,19 @@ std::shared_ptr<INotifyPropertyChanged> Serializer::deserialize()
 
 Serializer::Serializer(const char* filename, 
                        std::shared_ptr<TypeFactory> factory)
-    : _factory(factory)
+    : _doc(new XmlDocument()), _factory(factory)
 {
     ifstream theFile(filename);
-    _buffer = vector<char>((istreambuf_iterator<char>(theFile)), 
+    _doc->buffer = vector<char>((istreambuf_iterator<char>(theFile)), 
                                  istreambuf_iterator<char>());
-    _buffer.push_back('\0');
-    _doc.parse<0>(_buffer.data());
+    _doc->buffer.push_back('\0');
+    _doc->doc.parse<0>(_doc->buffer.data());
+}
+
+Serializer::Serializer(std::shared_ptr<XmlDocument> doc,
+                       std::shared_ptr<TypeFactory> factory)
+    : _doc(doc), _factory(factory)
+{
 }
 
 std::string find_attribute(xml_node<>* node, const std::string& name,
@@ -426,28 +340,24 @@ void Serializer::parse_container(Container* container,
     }
 }
 
-void parse_binding(const std::string& prop_text, 
-                   IPropertyDefinition* p_def,
-                   INotifyPropertyChanged* ptr,
-                   BindingBag& bindings)
+std::shared_ptr<const BindingExpression> BindingExpression::parse(
+    const std::string& text)
 {
-    MinimalParser p(prop_text);
-    p.try_get_string("{bind ");
-    auto element_id = p.get_id();
+    std::shared_ptr<BindingExpression> expr(new BindingExpression());
+    expr->text = text;
+    expr->mode = BindingMode::TwoWay;
     
-    std::string prop_name = "";
-    std::string converter_name = "|";
-    auto mode = BindingMode::TwoWay;
+    MinimalParser p(text);
+    p.try_get_string("{bind ");
+    expr->element = p.get_id();
+    expr->self_path.push_back(expr->element);
     
-    if (p.peek() == '.')
+    while (p.peek() == '.')
     {
-        p.req('.');
-        prop_name = p.get_id();
-        while (p.peek() == '.')
-        {
-            p.get();
-            prop_name += "." + p.get_id();
-        }
+        p.get();
+        auto id = p.get_id();
+        expr->path.push_back(id);
+        expr->self_path.push_back(id);
     }
 
     while (p.peek() == ',')
@@ -459,19 +369,19 @@ void parse_binding(const std::string& prop_text,
         {
             p.req('=');
             auto id = p.get_id();
-            if (converter_name != "|")
+            if (expr->converter.is_valid())
             {
                 throw std::runtime_error("Can't specify more then one converter!");
             }
-            converter_name = id;
+            expr->converter = id;
         }
         else if (id == "mode")
         {
             p.req('=');
             auto mode_str = to_lower(p.get_id());
-            if (mode_str == "oneway") mode = BindingMode::OneWay;
-            else if (mode_str == "twoway") mode = BindingMode::TwoWay;
-            else if (mode_str == "onetime") mode = BindingMode::OneTime;
+            if (mode_str == "oneway") expr->mode = BindingMode::OneWay;
+            else if (mode_str == "twoway") expr->mode = BindingMode::TwoWay;
+            else if (mode_str == "onetime") expr->mode = BindingMode::OneTime;
             else throw std::runtime_error(
                         str() << "Not supported binding mode " << mode_str);
 
@@ -480,17 +390,36 @@ void parse_binding(const std::string& prop_text,
     
     p.req('}');
     p.req_eof();
-    LOG(INFO) << "Parsing binding to " << element_id << "." << prop_name;
-    BindingDef binding
-        {
-            ptr,
-            p_def->get_name(), 
-            element_id,
-            prop_name,
-            converter_name,
-            mode
-        };
-    bindings.push_back(binding);
+    LOG(INFO) << "Parsed binding " << text;
+    return expr;
+}
+
+std::shared_ptr<const BindingExpression> BindingExpression::compile(
+    const std::string& text)
+{
+    static std::unordered_map<std::string, 
+                              std::shared_ptr<const BindingExpression>> cache;
+    static std::mutex cache_lock;
+    
+    {
+        std::lock_guard<std::mutex> lock(cache_lock);
+        auto it = cache.find(text);
+        if (it != cache.end()) return it->second;
+    }
+    
+    // parsed outside of the lock, a racing thread just parses it twice
+    auto expr = parse(text);
+    std::lock_guard<std::mutex> lock(cache_lock);
+    return cache.emplace(text, expr).first->second;
+}
+
+void parse_binding(const std::string& prop_text, 
+                   IPropertyDefinition* p_def,
+                   INotifyPropertyChanged* ptr,
+                   BindingBag& bindings)
+{
+    bindings.push_back({ ptr, p_def->get_id(), 
+                         BindingExpression::compile(prop_text) });
 }
 
 shared_ptr<INotifyPropertyChanged> Serializer::deserialize(
@@ -585,6 +514,26 @@ shared_ptr<INotifyPropertyChanged> Serializer::deserialize(
         if (grid) grid->commit_line();
     }
 
+    auto list = dynamic_cast<ListView*>(res.get());
+    if (list)
+    {
+        auto sub_node = node->first_node();
+        if (sub_node)
+        {
+            if (sub_node->next_sibling())
+                throw std::runtime_error("ListView should have a single item template!");
+            
+            // the template is instantiated straight from the parsed markup,
+            // so the document is kept alive for as long as the list needs it
+            auto doc = _doc;
+            auto factory = _factory;
+            list->set_item_template([doc, factory, sub_node, bag](IVisualElement* parent){
+                Serializer s(doc, factory);
+                return s.instantiate(parent, sub_node, bag);
+            });
+        }
+    }
+
     auto dict = dynamic_cast<FloatDictionary*>(res.get());
     if (dict)
     {
@@ -8,8 +8,8 @@
 #include "../rapidxml/rapidxml.hpp"
 
 #include "types.h"
+#include "bind.h"
 
-class INotifyPropertyChanged;
 struct BindingDef;
 typedef std::vector<rapidxml::xml_attribute<>*> AttrBag;
 typedef std::vector<BindingDef> BindingBag;
@@ -20,6 +20,32 @@ class Container;
 class IVisualElement;
 class TypeFactory;
 
+// A "{bind element.a.b, converter=x, mode=oneway}" attribute, parsed once
+// Expressions are cached by their text and shared by every element created
+// from the same markup, so instantiating a template does no parsing
+struct BindingExpression
+{
+    std::string text;
+    PropertyId element;
+    // path from the element, and the path to use when the element
+    // turns out to be a property of the bound object itself
+    std::vector<PropertyId> path;
+    std::vector<PropertyId> self_path;
+    // name of the converter element, not valid when there is none
+    PropertyId converter;
+    BindingMode mode;
+
+    static std::shared_ptr<const BindingExpression> compile(const std::string& text);
+    static std::shared_ptr<const BindingExpression> parse(const std::string& text);
+};
+
+// Parsed markup, shared with item templates that outlive the Serializer
+struct XmlDocument
+{
+    std::vector<char> buffer;
+    rapidxml::xml_document<> doc;
+};
+
 class Serializer
 {
 public:
@@ -27,6 +53,14 @@ public:
     
     std::shared_ptr<INotifyPropertyChanged> deserialize();
 private:
+    Serializer(std::shared_ptr<XmlDocument> doc, 
+               std::shared_ptr<TypeFactory> factory);
+
+    std::shared_ptr<INotifyPropertyChanged> instantiate(IVisualElement* parent,
+                                                        rapidxml::xml_node<>* node,
+                                                        const AttrBag& bag);
+                                                        
+
     void parse_container(Container* container, 
                          rapidxml::xml_node<>* node, 
                          const std::string& name,
@@ -40,8 +74,7 @@ private:
                                                         BindingBag& bindings,
                                                         ElementsMap& elements);
 
-    std::vector<char> _buffer;
-    rapidxml::xml_document<> _doc;
+    std::shared_ptr<XmlDocument> _doc;
     std::shared_ptr<TypeFactory> _factory;
 };
 
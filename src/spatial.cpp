@@ -0,0 +1,132 @@
+#include "spatial.h"
+
+#include <algorithm>
+
+using namespace std;
+
+SpatialGrid::SpatialGrid(int cell_size)
+    : _cell_size(std::max(cell_size, 1))
+{
+}
+
+SpatialGrid::CellKey SpatialGrid::get_key(int cx, int cy) const
+{
+    return ((CellKey)cx << 32) ^ (CellKey)(unsigned int)cy;
+}
+
+int SpatialGrid::to_cell(int x) const
+{
+    // round towards negative infinity, so negative coordinates work too
+    return (x >= 0) ? x / _cell_size : -((-x - 1) / _cell_size) - 1;
+}
+
+void SpatialGrid::insert_cells(int id, const Rect& rect)
+{
+    auto cx1 = to_cell(rect.position.x + rect.size.x);
+    auto cy1 = to_cell(rect.position.y + rect.size.y);
+    for (auto cy = to_cell(rect.position.y); cy <= cy1; cy++)
+    {
+        for (auto cx = to_cell(rect.position.x); cx <= cx1; cx++)
+        {
+            auto& cell = _cells[get_key(cx, cy)];
+            // keep every cell sorted by id, so z-order is preserved
+            cell.insert(upper_bound(cell.begin(), cell.end(), id), id);
+        }
+    }
+}
+
+void SpatialGrid::erase_cells(int id, const Rect& rect)
+{
+    auto cx1 = to_cell(rect.position.x + rect.size.x);
+    auto cy1 = to_cell(rect.position.y + rect.size.y);
+    for (auto cy = to_cell(rect.position.y); cy <= cy1; cy++)
+    {
+        for (auto cx = to_cell(rect.position.x); cx <= cx1; cx++)
+        {
+            auto it = _cells.find(get_key(cx, cy));
+            if (it == _cells.end()) continue;
+            
+            auto& cell = it->second;
+            auto pos = lower_bound(cell.begin(), cell.end(), id);
+            if (pos != cell.end() && *pos == id) cell.erase(pos);
+            if (cell.empty()) _cells.erase(it);
+        }
+    }
+}
+
+bool SpatialGrid::contains_id(int id) const
+{
+    return id >= 0 && id < (int)_present.size() && _present[id];
+}
+
+void SpatialGrid::update(int id, const Rect& rect)
+{
+    if (id >= (int)_rects.size())
+    {
+        _rects.resize(id + 1);
+        _present.resize(id + 1, false);
+    }
+    
+    if (_present[id])
+    {
+        if (_rects[id] == rect) return;
+        erase_cells(id, _rects[id]);
+    }
+    
+    _rects[id] = rect;
+    _present[id] = true;
+    insert_cells(id, rect);
+}
+
+void SpatialGrid::remove(int id)
+{
+    if (!contains_id(id)) return;
+    
+    erase_cells(id, _rects[id]);
+    _present[id] = false;
+}
+
+void SpatialGrid::clear()
+{
+    _cells.clear();
+    _rects.clear();
+    _present.clear();
+}
+
+int SpatialGrid::query_point(Int2 point) const
+{
+    auto it = _cells.find(get_key(to_cell(point.x), to_cell(point.y)));
+    if (it == _cells.end()) return -1;
+    
+    auto& cell = it->second;
+    for (auto i = cell.rbegin(); i != cell.rend(); ++i)
+    {
+        if (::contains(_rects[*i], point)) return *i;
+    }
+    return -1;
+}
+
+vector<int> SpatialGrid::query_rect(const Rect& rect) const
+{
+    vector<int> result;
+    
+    auto cx1 = to_cell(rect.position.x + rect.size.x);
+    auto cy1 = to_cell(rect.position.y + rect.size.y);
+    for (auto cy = to_cell(rect.position.y); cy <= cy1; cy++)
+    {
+        for (auto cx = to_cell(rect.position.x); cx <= cx1; cx++)
+        {
+            auto it = _cells.find(get_key(cx, cy));
+            if (it == _cells.end()) continue;
+            
+            for (auto id : it->second)
+            {
+                if (intersects(_rects[id], rect)) result.push_back(id);
+            }
+        }
+    }
+    
+    sort(result.begin(), result.end());
+    result.erase(unique(result.begin(), result.end()), result.end());
+    return result;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "types.h"
+
+// Uniform grid over a set of rects, identified by integer ids
+// Higher ids are considered to be on top of lower ones
+class SpatialGrid
+{
+public:
+    explicit SpatialGrid(int cell_size = 64);
+    
+    // Inserts the item, or moves it if it is already present
+    void update(int id, const Rect& rect);
+    void remove(int id);
+    void clear();
+    
+    bool contains_id(int id) const;
+    const Rect& get_rect(int id) const { return _rects[id]; }
+    
+    // Top-most item containing the point, or -1 if there is none
+    int query_point(Int2 point) const;
+    
+    // All items intersecting the rect, ordered bottom to top
+    std::vector<int> query_rect(const Rect& rect) const;
+
+private:
+    typedef long long CellKey;
+    
+    CellKey get_key(int cx, int cy) const;
+    int to_cell(int x) const;
+    
+    void insert_cells(int id, const Rect& rect);
+    void erase_cells(int id, const Rect& rect);
+
+    int _cell_size;
+    std::unordered_map<CellKey, std::vector<int>> _cells;
+    std::vector<Rect> _rects;
+    std::vector<bool> _present;
+};
+
+inline bool intersects(const Rect& a, const Rect& b)
+{
+    return a.position.x <= b.position.x + b.size.x &&
+           b.position.x <= a.position.x + a.size.x &&
+           a.position.y <= b.position.y + b.size.y &&
+           b.position.y <= a.position.y + a.size.y;
+}
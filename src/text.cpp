@@ -0,0 +1,240 @@
+#include "text.h"
+#include "font.h"
+
+#include <unordered_map>
+#include <algorithm>
+
+using namespace std;
+
+void TextLayout::set_font(const FontLoader* font)
+{
+    if (font == _font) return;
+    _font = font;
+
+    for (auto& p : _paragraphs)
+    {
+        measure(*p);
+        p->broken_width = -1;
+    }
+    _dirty = true;
+}
+
+void TextLayout::set_text(const std::string& text)
+{
+    if (text == _text && !_paragraphs.empty()) return;
+
+    // paragraphs are matched by content, so an edit only
+    // re-measures the paragraphs it actually touched
+    unordered_multimap<string, unique_ptr<Paragraph>> previous;
+    for (auto& p : _paragraphs)
+    {
+        auto key = p->text;
+        previous.emplace(move(key), move(p));
+    }
+    _paragraphs.clear();
+
+    auto begin = 0;
+    while (true)
+    {
+        auto end = text.find('\n', begin);
+        if (end == string::npos) end = text.size();
+
+        auto piece = text.substr(begin, end - begin);
+        unique_ptr<Paragraph> p;
+
+        auto it = previous.find(piece);
+        if (it != previous.end())
+        {
+            p = move(it->second);
+            previous.erase(it);
+        }
+        else
+        {
+            p.reset(new Paragraph());
+            p->text = move(piece);
+            measure(*p);
+        }
+
+        p->offset = begin;
+        _paragraphs.push_back(move(p));
+
+        if (end == text.size()) break;
+        begin = end + 1;
+    }
+
+    _text = text;
+    _dirty = true;
+}
+
+void TextLayout::measure(Paragraph& p) const
+{
+    p.words.clear();
+    p.natural_width = 0;
+    p.broken_width = -1;
+
+    auto& t = p.text;
+    auto n = (int)t.size();
+
+    auto advance = [this](char c) {
+        return _font ? _font->get_advance(c) : 0;
+    };
+    auto kerning = [this, &t, n](int i) {
+        return (_font && i + 1 < n) ? _font->get_kerning(t[i], t[i + 1]) : 0;
+    };
+
+    // leading spaces end up as the trailing part of an empty first word
+    auto i = 0;
+    while (i < n)
+    {
+        Word w { i, i, 0, 0 };
+        while (i < n && t[i] != ' ')
+        {
+            w.advance += advance(t[i]);
+            if (i + 1 < n && t[i + 1] != ' ') w.advance += kerning(i);
+            i++;
+        }
+        w.end = i;
+
+        if (i < n && i > w.begin) w.trailing += kerning(i - 1);
+        while (i < n && t[i] == ' ')
+        {
+            w.trailing += advance(t[i]) + kerning(i);
+            i++;
+        }
+        p.words.push_back(w);
+    }
+
+    for (auto j = 0; j < (int)p.words.size(); j++)
+    {
+        p.natural_width += p.words[j].advance;
+        if (j + 1 < (int)p.words.size()) p.natural_width += p.words[j].trailing;
+    }
+}
+
+void TextLayout::break_paragraph(Paragraph& p, int width) const
+{
+    p.lines.clear();
+    p.broken_width = width;
+
+    if (p.words.empty())
+    {
+        p.lines.push_back({ 0, 0, 0 });
+        return;
+    }
+
+    auto start = 0;
+    auto current = p.words[0].advance;
+    for (auto j = 1; j < (int)p.words.size(); j++)
+    {
+        auto candidate = current + p.words[j - 1].trailing + p.words[j].advance;
+        // the indentation is never left alone on a line
+        auto empty = (j - 1 == start) && p.words[start].begin == p.words[start].end;
+        if (candidate > width && !empty)
+        {
+            p.lines.push_back({ p.words[start].begin, p.words[j - 1].end, current });
+            start = j;
+            current = p.words[j].advance;
+        }
+        else
+        {
+            current = candidate;
+        }
+    }
+    p.lines.push_back({ p.words[start].begin, p.words.back().end, current });
+}
+
+const std::vector<TextLine>& TextLayout::break_lines(int width)
+{
+    if (!_dirty && width == _width) return _lines;
+
+    _lines.clear();
+    for (auto& p : _paragraphs)
+    {
+        if (p->broken_width != width) break_paragraph(*p, width);
+
+        for (auto& l : p->lines)
+        {
+            _lines.push_back({ l.begin + p->offset, l.end + p->offset, l.width });
+        }
+    }
+
+    _width = width;
+    _dirty = false;
+    _version++;
+    return _lines;
+}
+
+int TextLayout::get_natural_width() const
+{
+    auto width = 0;
+    for (auto& p : _paragraphs)
+    {
+        width = std::max(width, p->natural_width);
+    }
+    return width;
+}
+
+void GapBuffer::assign(const std::string& text)
+{
+    _data.assign(text.begin(), text.end());
+    _gap_begin = _gap_end = (int)_data.size();
+}
+
+void GapBuffer::move_gap(int pos)
+{
+    if (pos < _gap_begin)
+    {
+        auto count = _gap_begin - pos;
+        std::move_backward(_data.begin() + pos, _data.begin() + _gap_begin,
+                           _data.begin() + _gap_end);
+        _gap_begin -= count;
+        _gap_end -= count;
+    }
+    else if (pos > _gap_begin)
+    {
+        auto count = pos - _gap_begin;
+        std::move(_data.begin() + _gap_end, _data.begin() + _gap_end + count,
+                  _data.begin() + _gap_begin);
+        _gap_begin += count;
+        _gap_end += count;
+    }
+}
+
+void GapBuffer::reserve_gap(int count)
+{
+    if (_gap_end - _gap_begin >= count) return;
+
+    // grows geometrically, so a long run of inserts stays amortized O(1)
+    auto tail = (int)_data.size() - _gap_end;
+    auto gap = std::max(count, std::max(16, (int)_data.size() / 2));
+    _data.resize(_gap_begin + gap + tail);
+    std::move_backward(_data.begin() + _gap_end, _data.begin() + _gap_end + tail,
+                       _data.end());
+    _gap_end = _gap_begin + gap;
+}
+
+void GapBuffer::insert(int pos, const std::string& text)
+{
+    pos = std::max(0, std::min(pos, size()));
+    move_gap(pos);
+    reserve_gap((int)text.size());
+    std::copy(text.begin(), text.end(), _data.begin() + _gap_begin);
+    _gap_begin += (int)text.size();
+}
+
+void GapBuffer::erase(int pos, int count)
+{
+    pos = std::max(0, std::min(pos, size()));
+    count = std::max(0, std::min(count, size() - pos));
+    move_gap(pos);
+    _gap_end += count;
+}
+
+std::string GapBuffer::str() const
+{
+    std::string result;
+    result.reserve(size());
+    result.append(_data.begin(), _data.begin() + _gap_begin);
+    result.append(_data.begin() + _gap_end, _data.end());
+    return result;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+class FontLoader;
+
+// One wrapped line, as a byte range into the whole text
+// Width is in native font units and excludes trailing spaces
+struct TextLine
+{
+    int begin;
+    int end;
+    int width;
+};
+
+// Breaks text into lines that fit a given width
+// Text is split into paragraphs on '\n' and every paragraph is measured
+// once into words (advance of the word, advance of the spaces after it).
+// Changing the width only re-runs the greedy line breaking over the cached
+// words, and editing the text only re-measures paragraphs that changed.
+// Measurement uses the font metrics only, no GL context is needed
+class TextLayout
+{
+public:
+    // Changing the font drops everything measured so far
+    void set_font(const FontLoader* font);
+    const FontLoader* get_font() const { return _font; }
+
+    void set_text(const std::string& text);
+    const std::string& get_text() const { return _text; }
+
+    // Lines for the width, in native font units
+    // A word wider than the line is never split and gets a line of its own
+    const std::vector<TextLine>& break_lines(int width);
+
+    std::string get_line_text(const TextLine& line) const
+    {
+        return _text.substr(line.begin, line.end - line.begin);
+    }
+
+    // Width of the widest paragraph when nothing is wrapped
+    int get_natural_width() const;
+
+    // Incremented every time the lines returned by break_lines change
+    int get_version() const { return _version; }
+
+private:
+    struct Word
+    {
+        int begin;
+        int end;
+        int advance;
+        int trailing;
+    };
+
+    struct Paragraph
+    {
+        std::string text;
+        int offset = 0;
+        std::vector<Word> words;
+        int natural_width = 0;
+        int broken_width = -1;
+        std::vector<TextLine> lines;
+    };
+
+    void measure(Paragraph& p) const;
+    void break_paragraph(Paragraph& p, int width) const;
+
+    const FontLoader* _font = nullptr;
+    std::string _text;
+    std::vector<std::unique_ptr<Paragraph>> _paragraphs;
+    std::vector<TextLine> _lines;
+    int _width = -1;
+    bool _dirty = true;
+    int _version = 0;
+};
+
+// Characters of a text in two runs, like a GapBuffer around its gap
+// A plain string is a single run. Only valid until the text changes
+struct TextSpans
+{
+    TextSpans(const std::string& text)
+        : first(text.data()), first_size((int)text.size()),
+          second(nullptr), second_size(0)
+    {}
+    TextSpans(const char* first, int first_size, 
+              const char* second, int second_size)
+        : first(first), first_size(first_size),
+          second(second), second_size(second_size)
+    {}
+    
+    int size() const { return first_size + second_size; }
+    char operator[](int i) const
+    {
+        return (i < first_size) ? first[i] : second[i - first_size];
+    }
+    
+    const char* first;
+    int first_size;
+    const char* second;
+    int second_size;
+};
+
+// Editable text with a movable gap at the last edit position
+// Inserting or erasing next to the previous edit only moves the gap edges,
+// so typing is O(1) amortized regardless of the length of the text
+class GapBuffer
+{
+public:
+    void assign(const std::string& text);
+
+    void insert(int pos, const std::string& text);
+    void erase(int pos, int count);
+
+    int size() const { return (int)_data.size() - (_gap_end - _gap_begin); }
+    char operator[](int i) const
+    {
+        return (i < _gap_begin) ? _data[i] : _data[i + _gap_end - _gap_begin];
+    }
+
+    std::string str() const;
+    // The characters in place, without copying them
+    TextSpans spans() const
+    {
+        return { _data.data(), _gap_begin, 
+                 _data.data() + _gap_end, (int)_data.size() - _gap_end };
+    }
+
+private:
+    void move_gap(int pos);
+    void reserve_gap(int count);
+
+    std::vector<char> _data;
+    int _gap_begin = 0;
+    int _gap_end = 0;
+};
@@ -131,10 +131,21 @@ private:
     bool _is_pixels = true;
 };
 
+inline bool operator==(const Size& a, const Size& b)
+{
+    if (a.is_const() != b.is_const()) return false;
+    return a.is_const() ? a.get_pixels() == b.get_pixels()
+                        : a.get_percents() == b.get_percents();
+}
+
 struct Size2 
 { 
     Size x, y; 
 };
+inline bool operator==(const Size2& a, const Size2& b)
+{
+    return (a.x == b.x) && (a.y == b.y);
+}
 inline std::ostream & operator << (std::ostream & o, const Size& r) 
 { 
     if (r.is_auto()) o << "auto";
@@ -156,6 +167,12 @@ struct Int2 {
 inline bool operator==(const Int2& a, const Int2& b) {
     return (a.x == b.x) && (a.y == b.y);
 }
+inline Int2 operator+(const Int2& a, const Int2& b) {
+    return { a.x + b.x, a.y + b.y };
+}
+inline Int2 operator-(const Int2& a, const Int2& b) {
+    return { a.x - b.x, a.y - b.y };
+}
 inline std::ostream & operator << (std::ostream & o, const Int2& r) 
 { 
     return o << "(" << r.x << ", " << r.y << ")"; 
@@ -179,6 +196,16 @@ inline bool contains(const Rect& rect, const Int2& v)
            (rect.position.y <= v.y && rect.position.y + rect.size.y >= v.y);
 }
 
+// Common part of two rects, empty (zero size) if they are disjoint
+inline Rect intersection(const Rect& a, const Rect& b)
+{
+    auto x0 = std::max(a.position.x, b.position.x);
+    auto y0 = std::max(a.position.y, b.position.y);
+    auto x1 = std::min(a.position.x + a.size.x, b.position.x + b.size.x);
+    auto y1 = std::min(a.position.y + a.size.y, b.position.y + b.size.y);
+    return { { x0, y0 }, { std::max(0, x1 - x0), std::max(0, y1 - y0) } };
+}
+
 struct Margin
 {
     int left, right, top, bottom;
@@ -222,6 +249,28 @@ enum class MouseState
     up
 };
 
+// Keys with a meaning for editing, everything else arrives as characters
+enum class Key
+{
+    unknown,
+    left,
+    right,
+    home,
+    end,
+    backspace,
+    del,
+    enter,
+    escape,
+    a
+};
+
+// When an edited value is written back to its property
+enum class UpdateTrigger
+{
+    keystroke,
+    commit
+};
+
 enum class Alignment
 {
     left,
@@ -9,6 +9,74 @@ using namespace std;
 
 #include "../stb/stb_easy_font.h"
 
+#include <unordered_set>
+
+namespace
+{
+    struct TransactionState
+    {
+        int depth = 0;
+        bool committing = false;
+        std::vector<IVisualElement*> pending;
+        std::unordered_set<IVisualElement*> seen;
+    };
+    
+    TransactionState transaction;
+}
+
+LayoutTransaction::LayoutTransaction()
+{
+    transaction.depth++;
+}
+
+LayoutTransaction::~LayoutTransaction()
+{
+    if (--transaction.depth > 0) return;
+    
+    // when unwinding, the enlisted elements may already be gone
+    if (std::uncaught_exception())
+    {
+        transaction.pending.clear();
+        transaction.seen.clear();
+        return;
+    }
+    commit();
+}
+
+bool LayoutTransaction::is_active()
+{
+    return transaction.depth > 0 || transaction.committing;
+}
+
+bool LayoutTransaction::enlist(IVisualElement* element)
+{
+    if (transaction.committing)
+    {
+        // every element invalidates (and notifies its parent) once
+        return !transaction.seen.insert(element).second;
+    }
+    if (transaction.depth == 0) return false;
+    
+    if (transaction.seen.insert(element).second)
+    {
+        transaction.pending.push_back(element);
+    }
+    return true;
+}
+
+void LayoutTransaction::commit()
+{
+    std::vector<IVisualElement*> pending;
+    pending.swap(transaction.pending);
+    transaction.seen.clear();
+    
+    transaction.committing = true;
+    for (auto e : pending) e->invalidate_layout();
+    transaction.committing = false;
+    
+    transaction.seen.clear();
+}
+
 void ControlBase::update_parent(IVisualElement* new_parent) 
 {
     if (_parent != new_parent)
@@ -20,23 +88,19 @@ void ControlBase::update_parent(IVisualElement* new_parent)
         _parent = new_parent; 
         if (new_parent)
         {
-            new_parent->subscribe_on_change(this,
+            new_parent->subscribe_on_change(this, PropertyName("font"),
             [this](const char* prop_name)
             {
-                std::string prop(prop_name);
-                if (prop == "font")
+                LOG(INFO) << "parent of " << to_string() << " had his font changed!";
+                if (!_font.get())
                 {
-                    LOG(INFO) << "parent of " << to_string() << " had his font changed!";
-                    if (!_font.get())
-                    {
-                        LOG(INFO) << to_string() << " font is the same, so it also changed...";
-                        fire_property_change("font");
-                    }
+                    LOG(INFO) << to_string() << " font is the same, so it also changed...";
+                    fire_property_change(PropertyName("font"));
                 }
             });
         }
         
-        fire_property_change("parent");
+        fire_property_change(PropertyName("parent"));
     }
    
 }
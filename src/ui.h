@@ -59,6 +59,40 @@ public:
     virtual ~IVisualElement() {}
 };
 
+// Collection that can be presented by an items control
+// Items are requested on demand, so the collection may be virtual
+class IItemsSource
+{
+public:
+    virtual int get_count() const = 0;
+    virtual std::shared_ptr<INotifyPropertyChanged> get_item(int index) = 0;
+    
+    virtual ~IItemsSource() {}
+};
+
+// Defers layout invalidation for as long as it is alive
+// Elements invalidated meanwhile are remembered, and invalidated once
+// when the outermost transaction commits, each ancestor being visited
+// only once no matter how many of its descendants changed
+class LayoutTransaction
+{
+public:
+    LayoutTransaction();
+    ~LayoutTransaction();
+    
+    LayoutTransaction(const LayoutTransaction&) = delete;
+    LayoutTransaction& operator=(const LayoutTransaction&) = delete;
+    
+    static bool is_active();
+    
+    // Called at the start of invalidate_layout
+    // Returns true if the element should not invalidate right now
+    static bool enlist(IVisualElement* element);
+    
+private:
+    void commit();
+};
+
 typedef std::chrono::time_point<std::chrono::high_resolution_clock> TimePoint;
 
 class ControlBase : public IVisualElement
@@ -97,14 +131,14 @@ public:
     void set_position(const Size2& val) 
     { 
         _position = val; 
-        fire_property_change("position");
+        fire_property_change(PropertyName("position"));
     }
 
     Rect arrange(const Rect& origin) override;
     void invalidate_layout() override 
     {
-        if (get_parent()) get_parent()->invalidate_layout();
-        else LOG(INFO) << "UI Layout has invalidated! " << get_name();
+        if (LayoutTransaction::enlist(this)) return;
+        invalidate_parent_layout();
     }
     
     void update_mouse_position(Int2 cursor) override {}
@@ -113,15 +147,16 @@ public:
     void set_size(const Size2& val) 
     { 
         _size = val; 
-        fire_property_change("size");
+        fire_property_change(PropertyName("size"));
     }
     
     Size2 get_intrinsic_size() const override { return _size; };
 
     void set_focused(bool on) override 
     { 
+        if (_focused == on) return;
         _focused = on; 
-        fire_property_change("focused");
+        fire_property_change(PropertyName("focused"));
     }
     bool is_focused() const override { return _focused; }
     
@@ -129,20 +164,20 @@ public:
     void set_name(const std::string& val) 
     { 
         _name = val;
-        fire_property_change("name"); 
+        fire_property_change(PropertyName("name")); 
     }
     
     Alignment get_align() const override { return _align; }
     void set_align(Alignment align) 
     { 
         _align = align; 
-        fire_property_change("alignment");
+        fire_property_change(PropertyName("alignment"));
     }
     
     void set_enabled(bool on) override 
     { 
         _enabled = on; 
-        fire_property_change("enabled");
+        fire_property_change(PropertyName("enabled"));
     }
     bool is_enabled() const override { return _enabled; }
     
@@ -150,7 +185,7 @@ public:
     { 
         _visible = on;
         invalidate_layout();
-        fire_property_change("visible");
+        fire_property_change(PropertyName("visible"));
     }
     bool is_visible() const override { return _visible; }
     
@@ -174,22 +209,27 @@ public:
     void set_data_context(std::shared_ptr<INotifyPropertyChanged> dc) override 
     {
         _dc = dc; 
-        fire_property_change("data_context");
+        fire_property_change(PropertyName("data_context"));
     }
     std::shared_ptr<INotifyPropertyChanged> get_data_context() const override 
     { 
         return _dc; 
     }
     
-    void fire_property_change(const char* property_name) override
+    void fire_property_change(PropertyId prop) override
     {
-        _base.fire_property_change(property_name);
+        _base.fire_property_change(prop);
     }
     void subscribe_on_change(void* owner, 
                              OnFieldChangeCallback on_change) override
     {
         _base.subscribe_on_change(owner, on_change);
     }
+    void subscribe_on_change(void* owner, PropertyId prop,
+                             OnFieldChangeCallback on_change) override
+    {
+        _base.subscribe_on_change(owner, prop, on_change);
+    }
     void unsubscribe_on_change(void* owner) override
     {
         _base.unsubscribe_on_change(owner);
@@ -203,7 +243,7 @@ public:
     void set_font(std::shared_ptr<INotifyPropertyChanged> font) override
     {
         _font = font;
-        fire_property_change("font");
+        fire_property_change(PropertyName("font"));
     }
     const std::shared_ptr<INotifyPropertyChanged>& get_font() const 
     {
@@ -227,6 +267,12 @@ protected:
     {
         return _render_context;
     }
+    
+    void invalidate_parent_layout()
+    {
+        if (get_parent()) get_parent()->invalidate_layout();
+        else LOG(INFO) << "UI Layout has invalidated! " << get_name();
+    }
 
 private:
     Size2 _position = {0,0};
@@ -237,9 +283,10 @@ private:
     bool _enabled = true;
     bool _visible = true;
     IVisualElement* _parent = nullptr;
+    // declared before the bindings, so it outlives their unsubscription
+    BindableObjectBase _base;
     std::vector<std::unique_ptr<Binding>> _bindings;
     std::shared_ptr<INotifyPropertyChanged> _dc = nullptr;
-    BindableObjectBase _base;
     
     std::map<MouseButton, MouseState> _state;
     std::map<MouseButton, TimePoint> _last_update;